@@ -0,0 +1,220 @@
+//
+// Earliest deadline first scheduling class, on top of the policy chosen by uthread_init_ex.
+//
+
+#include "DeadlinePolicy.h"
+#include "Thread.h"
+#include <climits>
+#include <time.h>
+
+#define FULL_CPU_PPM 1000000LL
+
+DeadlinePolicy::DeadlinePolicy()
+    : base(nullptr), ready(&DeadlinePolicy::earlier_deadline), waiting(&DeadlinePolicy::earlier_release),
+      total_density_ppm(0) {}
+
+void DeadlinePolicy::init(SchedulingPolicy* base)
+{
+    this->base = base;
+}
+
+bool DeadlinePolicy::set_params(Thread* thread, long long runtime_ns, long long deadline_ns, long long period_ns)
+{
+    long long old_density = thread->dl_period_ns > 0 ? density_ppm(thread) : 0;
+    long long new_density = period_ns > 0 ? runtime_ns * FULL_CPU_PPM / deadline_ns : 0;
+    if (total_density_ppm - old_density + new_density > FULL_CPU_PPM) {
+        return false;
+    }
+    total_density_ppm += new_density - old_density;
+    thread->dl_runtime_ns = runtime_ns;
+    thread->dl_deadline_ns = deadline_ns;
+    thread->dl_period_ns = period_ns;
+    // the first job is released right away
+    thread->dl_release_ns = now();
+    thread->dl_budget_ns = runtime_ns;
+    thread->dl_done = false;
+    return true;
+}
+
+void DeadlinePolicy::finish_job(Thread* thread)
+{
+    if (now() > thread->dl_release_ns + thread->dl_deadline_ns) {
+        thread->dl_misses++;
+    }
+    thread->dl_done = true;
+}
+
+void DeadlinePolicy::enqueue(Thread* thread)
+{
+    if (thread->dl_period_ns == 0) {
+        base->enqueue(thread);
+        return;
+    }
+    advance(thread, now());
+    if (thread->dl_done || thread->dl_budget_ns <= 0) {
+        waiting.insert(thread);
+    } else {
+        ready.insert(thread);
+    }
+}
+
+Thread* DeadlinePolicy::dequeue_next()
+{
+    if (!ready.empty()) {
+        return ready.pop_min();
+    }
+    return base->dequeue_next();
+}
+
+void DeadlinePolicy::remove(Thread* thread)
+{
+    ready.remove(thread);
+    waiting.remove(thread);
+    base->remove(thread);
+}
+
+bool DeadlinePolicy::contains(const Thread* thread) const
+{
+    return ready.contains(thread) || waiting.contains(thread) || base->contains(thread);
+}
+
+// A thread of the base policy can't go before a deadline thread with a job to run
+bool DeadlinePolicy::can_pick(const Thread* thread) const
+{
+    if (ready.contains(thread)) {
+        return true;
+    }
+    return ready.empty() && base->can_pick(thread);
+}
+
+// Throttled threads are held but can't run, so the policy can be empty with a non-zero size
+bool DeadlinePolicy::empty() const
+{
+    return ready.empty() && base->empty();
+}
+
+int DeadlinePolicy::size() const
+{
+    return ready.size() + waiting.size() + base->size();
+}
+
+void DeadlinePolicy::charge(Thread* thread, long long ns)
+{
+    if (thread->dl_period_ns > 0) {
+        thread->dl_budget_ns -= ns;
+    } else {
+        base->charge(thread, ns);
+    }
+}
+
+// Releases the waiting threads whose next period has started
+void DeadlinePolicy::on_clock(long long now_ns)
+{
+    while (!waiting.empty()) {
+        Thread* thread = waiting.min();
+        if (thread->dl_release_ns + thread->dl_period_ns > now_ns) {
+            break;
+        }
+        waiting.pop_min();
+        advance(thread, now_ns);
+        ready.insert(thread);
+    }
+    base->on_clock(now_ns);
+}
+
+// The running thread gives the CPU up right away (0) if a ready deadline thread is due before it, otherwise at the
+// earliest of its own runtime running out and the next release
+long long DeadlinePolicy::next_event_ns(const Thread* running, long long running_since_ns) const
+{
+    long long event = base->next_event_ns(running, running_since_ns);
+    bool running_has_deadline = running != nullptr && running->dl_period_ns > 0;
+    if (!ready.empty() && running != nullptr &&
+        (!running_has_deadline || earlier_deadline(ready.min(), running))) {
+        return 0;
+    }
+    if (running_has_deadline && running_since_ns + running->dl_budget_ns < event) {
+        event = running_since_ns + running->dl_budget_ns;
+    }
+    if (!waiting.empty()) {
+        Thread* next = waiting.min();
+        if (next->dl_release_ns + next->dl_period_ns < event) {
+            event = next->dl_release_ns + next->dl_period_ns;
+        }
+    }
+    return event;
+}
+
+void DeadlinePolicy::on_quantum(int quantum)
+{
+    base->on_quantum(quantum);
+}
+
+void DeadlinePolicy::on_tick(Thread* thread)
+{
+    if (thread->dl_period_ns == 0) {
+        base->on_tick(thread);
+    }
+}
+
+void DeadlinePolicy::on_block(Thread* thread)
+{
+    if (thread->dl_period_ns == 0) {
+        base->on_block(thread);
+    }
+}
+
+void DeadlinePolicy::on_wake(Thread* thread)
+{
+    if (thread->dl_period_ns == 0) {
+        base->on_wake(thread);
+    }
+}
+
+// A deadline thread runs until its runtime is used up or a deadline preempts it, the quantum only bounds the time
+// between two looks at the ready deadline threads
+int DeadlinePolicy::time_slice(const Thread* thread) const
+{
+    return thread->dl_period_ns > 0 ? 1 : base->time_slice(thread);
+}
+
+// Moves the thread's current job to the period that contains now_ns. A job that is skipped before it was done
+// missed its deadline.
+void DeadlinePolicy::advance(Thread* thread, long long now_ns)
+{
+    if (now_ns < thread->dl_release_ns + thread->dl_period_ns) {
+        return;
+    }
+    if (!thread->dl_done) {
+        thread->dl_misses++;
+    }
+    thread->dl_release_ns += (now_ns - thread->dl_release_ns) / thread->dl_period_ns * thread->dl_period_ns;
+    thread->dl_budget_ns = thread->dl_runtime_ns;
+    thread->dl_done = false;
+}
+
+// Earliest absolute deadline first, ties go to the smaller thread id
+bool DeadlinePolicy::earlier_deadline(const Thread* a, const Thread* b)
+{
+    long long da = a->dl_release_ns + a->dl_deadline_ns;
+    long long db = b->dl_release_ns + b->dl_deadline_ns;
+    return da < db || (da == db && a->thread_id < b->thread_id);
+}
+
+bool DeadlinePolicy::earlier_release(const Thread* a, const Thread* b)
+{
+    long long ra = a->dl_release_ns + a->dl_period_ns;
+    long long rb = b->dl_release_ns + b->dl_period_ns;
+    return ra < rb || (ra == rb && a->thread_id < b->thread_id);
+}
+
+long long DeadlinePolicy::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+long long DeadlinePolicy::density_ppm(const Thread* thread)
+{
+    return thread->dl_runtime_ns * FULL_CPU_PPM / thread->dl_deadline_ns;
+}
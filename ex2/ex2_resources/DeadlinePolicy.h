@@ -0,0 +1,68 @@
+//
+// Earliest deadline first scheduling class, on top of the policy chosen by uthread_init_ex.
+//
+
+#ifndef EX2_RESOURCES_DEADLINEPOLICY_H
+#define EX2_RESOURCES_DEADLINEPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "PairingHeap.h"
+
+// A deadline thread (Thread::dl_period_ns > 0) runs periodic jobs: a job is released every period, may run for
+// dl_runtime_ns and is due dl_deadline_ns after its release. Times are CLOCK_MONOTONIC nanoseconds.
+// Ready deadline threads always run before the threads of the base policy, earliest absolute deadline first, and a
+// deadline thread that becomes ready with an earlier deadline than the running thread's preempts it (see
+// next_event_ns). A job ends when its thread calls uthread_wait_period; the thread then waits here, still READY, for
+// its next release. A job that uses up its runtime is throttled the same way, so a thread that overruns can't take
+// more than its reserved share of the CPU from the others.
+// A job that is not done by its deadline is a miss, counted in Thread::dl_misses.
+// Admission control keeps the sum of runtime / deadline of all deadline threads at most 1, which is enough for EDF
+// to meet every deadline of threads that stay within their runtime.
+// Every other call is passed on to the base policy, so threads without a deadline are scheduled as before.
+class DeadlinePolicy : public SchedulingPolicy {
+public:
+    DeadlinePolicy();
+
+    void init(SchedulingPolicy* base);
+
+    // Makes thread a deadline thread with the given parameters, or a regular one again if period_ns is 0. The
+    // thread must not be held by the policy (take it out with remove first). Returns false, and changes nothing, if
+    // the deadline threads would then need more than the whole CPU.
+    bool set_params(Thread* thread, long long runtime_ns, long long deadline_ns, long long period_ns);
+    // Ends the running deadline thread's current job, it waits for its next release once it is enqueued
+    void finish_job(Thread* thread);
+
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    bool can_pick(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+    void charge(Thread* thread, long long ns) override;
+    void on_clock(long long now_ns) override;
+    long long next_event_ns(const Thread* running, long long running_since_ns) const override;
+    void on_quantum(int quantum) override;
+    void on_tick(Thread* thread) override;
+    void on_block(Thread* thread) override;
+    void on_wake(Thread* thread) override;
+    int time_slice(const Thread* thread) const override;
+
+private:
+    static bool earlier_deadline(const Thread* a, const Thread* b);
+    static bool earlier_release(const Thread* a, const Thread* b);
+    static long long now();
+    static long long density_ppm(const Thread* thread);
+
+    void advance(Thread* thread, long long now_ns);
+
+    SchedulingPolicy* base;
+    PairingHeap ready; // deadline threads with a job to run, by absolute deadline
+    PairingHeap waiting; // deadline threads whose job is done or throttled, by next release
+    long long total_density_ppm; // sum of runtime / deadline of the deadline threads, in millionths
+};
+
+
+#endif //EX2_RESOURCES_DEADLINEPOLICY_H
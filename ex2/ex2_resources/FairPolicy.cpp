@@ -0,0 +1,62 @@
+//
+// Fair-share scheduling policy: CPU time in proportion to the threads' weights.
+//
+
+#include "FairPolicy.h"
+#include "Thread.h"
+
+FairPolicy::FairPolicy() : ready(&FairPolicy::before), min_vruntime(0), wakeup_credit(0) {}
+
+void FairPolicy::init(long long quantum_ns)
+{
+    wakeup_credit = quantum_ns / 2;
+}
+
+void FairPolicy::enqueue(Thread* thread)
+{
+    long long floor = min_vruntime - wakeup_credit;
+    if (thread->vruntime < floor) {
+        thread->vruntime = floor;
+    }
+    ready.insert(thread);
+}
+
+Thread* FairPolicy::dequeue_next()
+{
+    Thread* thread = ready.pop_min();
+    if (thread != nullptr && thread->vruntime > min_vruntime) {
+        min_vruntime = thread->vruntime;
+    }
+    return thread;
+}
+
+void FairPolicy::remove(Thread* thread)
+{
+    ready.remove(thread);
+}
+
+bool FairPolicy::contains(const Thread* thread) const
+{
+    return ready.contains(thread);
+}
+
+bool FairPolicy::empty() const
+{
+    return ready.empty();
+}
+
+int FairPolicy::size() const
+{
+    return ready.size();
+}
+
+void FairPolicy::charge(Thread* thread, long long ns)
+{
+    thread->vruntime += ns * UTHREAD_DEFAULT_WEIGHT / thread->weight;
+}
+
+// Smallest virtual runtime first, ties go to the smaller thread id
+bool FairPolicy::before(const Thread* a, const Thread* b)
+{
+    return a->vruntime < b->vruntime || (a->vruntime == b->vruntime && a->thread_id < b->thread_id);
+}
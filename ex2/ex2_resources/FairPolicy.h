@@ -0,0 +1,43 @@
+//
+// Fair-share scheduling policy: CPU time in proportion to the threads' weights.
+//
+
+#ifndef EX2_RESOURCES_FAIRPOLICY_H
+#define EX2_RESOURCES_FAIRPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "PairingHeap.h"
+
+// Every thread has a virtual runtime (Thread::vruntime): the nanoseconds it actually ran, scaled down by its weight
+// relative to UTHREAD_DEFAULT_WEIGHT. The ready thread with the smallest virtual runtime runs next, so over time each
+// thread's share of the CPU converges to its share of the total weight, and a thread that gives the CPU up early is
+// only charged for what it used.
+// min_vruntime follows the virtual runtime of the threads picked to run and never goes back. A thread that joins the
+// ready threads (spawned, or back from a block or sleep) is placed no further back than half a quantum behind it:
+// a sleeper gets to run soon, but it can't make up for all the time it was away.
+class FairPolicy : public SchedulingPolicy {
+public:
+    FairPolicy();
+
+    void init(long long quantum_ns);
+
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+    void charge(Thread* thread, long long ns) override;
+
+private:
+    static bool before(const Thread* a, const Thread* b);
+
+    PairingHeap ready;
+    long long min_vruntime;
+    long long wakeup_credit; // how far behind min_vruntime an enqueued thread may be
+};
+
+
+#endif //EX2_RESOURCES_FAIRPOLICY_H
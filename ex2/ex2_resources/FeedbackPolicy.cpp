@@ -0,0 +1,88 @@
+//
+// Multi-level feedback queue scheduling policy.
+//
+
+#include "FeedbackPolicy.h"
+#include "Thread.h"
+
+FeedbackPolicy::FeedbackPolicy() : boost_quantums(1), epoch(0) {}
+
+void FeedbackPolicy::init(int levels, int boost_quantums)
+{
+    ready.init(levels);
+    this->boost_quantums = boost_quantums;
+}
+
+void FeedbackPolicy::enqueue(Thread* thread)
+{
+    ready.push_back(thread);
+}
+
+Thread* FeedbackPolicy::dequeue_next()
+{
+    return ready.pop_front();
+}
+
+void FeedbackPolicy::remove(Thread* thread)
+{
+    ready.remove(thread);
+    thread->boost_epoch = epoch;
+}
+
+bool FeedbackPolicy::contains(const Thread* thread) const
+{
+    return ready.contains(thread);
+}
+
+bool FeedbackPolicy::empty() const
+{
+    return ready.empty();
+}
+
+int FeedbackPolicy::size() const
+{
+    return ready.size();
+}
+
+void FeedbackPolicy::on_quantum(int quantum)
+{
+    if (quantum % boost_quantums == 0) {
+        boost();
+    }
+}
+
+void FeedbackPolicy::on_tick(Thread* thread)
+{
+    if (thread->priority < ready.levels() - 1) {
+        thread->priority++;
+    }
+}
+
+void FeedbackPolicy::on_block(Thread* thread)
+{
+    if (thread->priority > 0) {
+        thread->priority--;
+    }
+    thread->boost_epoch = epoch;
+}
+
+void FeedbackPolicy::on_wake(Thread* thread)
+{
+    if (thread->boost_epoch != epoch) {
+        thread->priority = 0; // it missed a boost while it was blocked
+    }
+}
+
+int FeedbackPolicy::time_slice(const Thread* thread) const
+{
+    long quantums = 1L << thread->priority;
+    return quantums < boost_quantums ? (int) quantums : boost_quantums;
+}
+
+// Moves the ready threads to the top level right away. The running thread is already queued or blocked by the time a
+// quantum starts, and the blocked ones are moved when they wake up.
+void FeedbackPolicy::boost()
+{
+    epoch++;
+    ready.flatten();
+}
@@ -0,0 +1,46 @@
+//
+// Multi-level feedback queue scheduling policy.
+//
+
+#ifndef EX2_RESOURCES_FEEDBACKPOLICY_H
+#define EX2_RESOURCES_FEEDBACKPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "FeedbackQueue.h"
+
+// The highest non-empty level runs first, round robin within a level, and the quantum doubles with every level down
+// (up to the boost period). A thread that uses up its quantum moves down a level, one that blocks or sleeps before
+// that moves up a level. Every boost_quantums quantums all threads go back to the top level, so that nothing starves
+// behind a stream of short threads: the ready ones right away, the blocked and sleeping ones when they wake up
+// (Thread::boost_epoch tells whether they missed a boost).
+class FeedbackPolicy : public SchedulingPolicy {
+public:
+    FeedbackPolicy();
+
+    void init(int levels, int boost_quantums);
+
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+    void on_quantum(int quantum) override;
+    void on_tick(Thread* thread) override;
+    void on_block(Thread* thread) override;
+    void on_wake(Thread* thread) override;
+
+    int time_slice(const Thread* thread) const override;
+
+private:
+    void boost();
+
+    FeedbackQueue ready;
+    int boost_quantums;
+    int epoch; // number of boosts so far
+};
+
+
+#endif //EX2_RESOURCES_FEEDBACKPOLICY_H
@@ -0,0 +1,82 @@
+//
+// Ready queue of the multi-level feedback queue scheduler: one FIFO per priority level.
+//
+
+#include "FeedbackQueue.h"
+#include "Thread.h"
+
+FeedbackQueue::FeedbackQueue() : nonempty(0), level_count(1), count(0) {}
+
+void FeedbackQueue::init(int levels)
+{
+    level_count = levels;
+}
+
+int FeedbackQueue::levels() const
+{
+    return level_count;
+}
+
+bool FeedbackQueue::empty() const
+{
+    return count == 0;
+}
+
+int FeedbackQueue::size() const
+{
+    return count;
+}
+
+Thread* FeedbackQueue::front() const
+{
+    if (nonempty == 0) {
+        return nullptr;
+    }
+    return queues[__builtin_ctz(nonempty)].front();
+}
+
+bool FeedbackQueue::contains(const Thread* thread) const
+{
+    return thread != nullptr && queues[thread->priority].contains(thread);
+}
+
+void FeedbackQueue::push_back(Thread* thread)
+{
+    queues[thread->priority].push_back(thread);
+    nonempty |= 1u << thread->priority;
+    count++;
+}
+
+Thread* FeedbackQueue::pop_front()
+{
+    Thread* thread = front();
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+void FeedbackQueue::remove(Thread* thread)
+{
+    if (!contains(thread)) {
+        return;
+    }
+    ThreadQueue& queue = queues[thread->priority];
+    queue.remove(thread);
+    if (queue.empty()) {
+        nonempty &= ~(1u << thread->priority);
+    }
+    count--;
+}
+
+void FeedbackQueue::flatten()
+{
+    for (int level = 1; level < level_count; level++) {
+        while (!queues[level].empty()) {
+            Thread* thread = queues[level].pop_front();
+            thread->priority = 0;
+            queues[0].push_back(thread);
+        }
+    }
+    nonempty = queues[0].empty() ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+//
+// Ready queue of the multi-level feedback queue scheduler: one FIFO per priority level.
+//
+
+#ifndef EX2_RESOURCES_FEEDBACKQUEUE_H
+#define EX2_RESOURCES_FEEDBACKQUEUE_H
+
+#include "ThreadQueue.h"
+
+#define MAX_PRIORITY_LEVELS 32
+
+class Thread;
+
+// A thread is queued at the level in Thread::priority (0 is the highest), which must not change while it is queued.
+// A bitmap has bit l set while level l is not empty, so the highest non-empty level is one count-trailing-zeros
+// away and push, pop and remove are all O(1) whatever the number of levels.
+// With a single level this is the plain round robin FIFO.
+class FeedbackQueue {
+public:
+    FeedbackQueue();
+
+    void init(int levels); // must be called while the queue is empty
+    int levels() const;
+
+    bool empty() const;
+    int size() const;
+    Thread* front() const; // head of the highest non-empty level
+    bool contains(const Thread* thread) const;
+
+    void push_back(Thread* thread); // to the back of level thread->priority
+    Thread* pop_front(); // returns nullptr if the queue is empty
+    void remove(Thread* thread); // no effect if the thread is not in this queue
+
+    // Moves every thread to level 0, behind the ones already there, keeping the order of the levels and of each level
+    void flatten();
+
+private:
+    ThreadQueue queues[MAX_PRIORITY_LEVELS];
+    unsigned int nonempty; // bit l is set while queues[l] is not empty
+    int level_count;
+    int count;
+};
+
+
+#endif //EX2_RESOURCES_FEEDBACKQUEUE_H
@@ -0,0 +1,205 @@
+//
+// Thread groups: CPU time shared among groups first, then among the threads of a group.
+//
+
+#include "GroupPolicy.h"
+#include "Thread.h"
+
+GroupPolicy::GroupPolicy() : base(nullptr), count(1), min_vruntime(0)
+{
+    groups[0].shares = UTHREAD_DEFAULT_WEIGHT;
+    groups[0].quota_ns = 0;
+    groups[0].period_ns = 0;
+    groups[0].period_start_ns = 0;
+    groups[0].period_usage_ns = 0;
+    groups[0].usage_ns = 0;
+    groups[0].vruntime = 0;
+    for (int i = 0; i < UTHREAD_MAX_GROUPS; i++) {
+        groups[i].threads = &groups[i].fair;
+    }
+}
+
+void GroupPolicy::init(SchedulingPolicy* base, long long quantum_ns)
+{
+    this->base = base;
+    groups[0].threads = base;
+    for (int i = 1; i < UTHREAD_MAX_GROUPS; i++) {
+        groups[i].fair.init(quantum_ns);
+    }
+}
+
+int GroupPolicy::create(int shares, long long quota_ns, long long period_ns)
+{
+    if (count == UTHREAD_MAX_GROUPS) {
+        return -1;
+    }
+    Group& group = groups[count];
+    group.shares = shares;
+    group.quota_ns = quota_ns;
+    group.period_ns = period_ns;
+    group.period_start_ns = 0; // the first on_clock starts the first period
+    group.period_usage_ns = 0;
+    group.usage_ns = 0;
+    group.vruntime = min_vruntime;
+    return count++;
+}
+
+bool GroupPolicy::exists(int group) const
+{
+    return group >= 0 && group < count;
+}
+
+long long GroupPolicy::usage_ns(int group) const
+{
+    return groups[group].usage_ns;
+}
+
+void GroupPolicy::enqueue(Thread* thread)
+{
+    Group& group = groups[thread->group];
+    SchedulingPolicy* threads = threads_of(thread->group);
+    if (threads->empty() && group.vruntime < min_vruntime) {
+        group.vruntime = min_vruntime;
+    }
+    threads->enqueue(thread);
+}
+
+Thread* GroupPolicy::dequeue_next()
+{
+    int group = next_group();
+    if (group < 0) {
+        return nullptr;
+    }
+    if (groups[group].vruntime > min_vruntime) {
+        min_vruntime = groups[group].vruntime;
+    }
+    return threads_of(group)->dequeue_next();
+}
+
+void GroupPolicy::remove(Thread* thread)
+{
+    threads_of(thread->group)->remove(thread);
+}
+
+bool GroupPolicy::contains(const Thread* thread) const
+{
+    return threads_of(thread->group)->contains(thread);
+}
+
+// A thread of a group that used up its quota has to wait for the next period like the others
+bool GroupPolicy::can_pick(const Thread* thread) const
+{
+    return runnable(thread->group) && threads_of(thread->group)->can_pick(thread);
+}
+
+// Threads of a group that used up its quota are held but can't run, so the policy can be empty with a non-zero size
+bool GroupPolicy::empty() const
+{
+    return next_group() < 0;
+}
+
+int GroupPolicy::size() const
+{
+    int size = 0;
+    for (int i = 0; i < count; i++) {
+        size += threads_of(i)->size();
+    }
+    return size;
+}
+
+void GroupPolicy::charge(Thread* thread, long long ns)
+{
+    Group& group = groups[thread->group];
+    group.usage_ns += ns;
+    group.period_usage_ns += ns;
+    group.vruntime += ns * UTHREAD_DEFAULT_WEIGHT / group.shares;
+    threads_of(thread->group)->charge(thread, ns);
+}
+
+// Starts a new period for the groups with a quota whose period is over
+void GroupPolicy::on_clock(long long now_ns)
+{
+    for (int i = 1; i < count; i++) {
+        Group& group = groups[i];
+        if (group.quota_ns > 0 && now_ns >= group.period_start_ns + group.period_ns) {
+            group.period_start_ns = now_ns - (now_ns - group.period_start_ns) % group.period_ns;
+            group.period_usage_ns = 0;
+        }
+    }
+    base->on_clock(now_ns);
+}
+
+// The running thread gives the CPU up when its group's quota runs out. While nothing runs, the scheduler has to look
+// again when a group that used up its quota gets a new one.
+long long GroupPolicy::next_event_ns(const Thread* running, long long running_since_ns) const
+{
+    long long event = base->next_event_ns(running, running_since_ns);
+    if (running != nullptr) {
+        const Group& group = groups[running->group];
+        if (group.quota_ns > 0) {
+            long long left = group.quota_ns - group.period_usage_ns;
+            if (left <= 0) {
+                return 0;
+            }
+            if (running_since_ns + left < event) {
+                event = running_since_ns + left;
+            }
+        }
+        return event;
+    }
+    for (int i = 1; i < count; i++) {
+        const Group& group = groups[i];
+        if (group.quota_ns > 0 && !threads_of(i)->empty() && group.period_start_ns + group.period_ns < event) {
+            event = group.period_start_ns + group.period_ns;
+        }
+    }
+    return event;
+}
+
+void GroupPolicy::on_quantum(int quantum)
+{
+    base->on_quantum(quantum);
+}
+
+void GroupPolicy::on_tick(Thread* thread)
+{
+    threads_of(thread->group)->on_tick(thread);
+}
+
+void GroupPolicy::on_block(Thread* thread)
+{
+    threads_of(thread->group)->on_block(thread);
+}
+
+void GroupPolicy::on_wake(Thread* thread)
+{
+    threads_of(thread->group)->on_wake(thread);
+}
+
+int GroupPolicy::time_slice(const Thread* thread) const
+{
+    return threads_of(thread->group)->time_slice(thread);
+}
+
+SchedulingPolicy* GroupPolicy::threads_of(int group) const
+{
+    return groups[group].threads;
+}
+
+bool GroupPolicy::runnable(int group) const
+{
+    const Group& g = groups[group];
+    return !threads_of(group)->empty() && (g.quota_ns == 0 || g.period_usage_ns < g.quota_ns);
+}
+
+// The runnable group with the smallest virtual runtime, ties go to the smaller id. -1 if there is none.
+int GroupPolicy::next_group() const
+{
+    int next = -1;
+    for (int i = 0; i < count; i++) {
+        if (runnable(i) && (next < 0 || groups[i].vruntime < groups[next].vruntime)) {
+            next = i;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,75 @@
+//
+// Thread groups: CPU time shared among groups first, then among the threads of a group.
+//
+
+#ifndef EX2_RESOURCES_GROUPPOLICY_H
+#define EX2_RESOURCES_GROUPPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "FairPolicy.h"
+#include "uthreads.h"
+
+// Group 0 holds the threads spawned without a group, and schedules them with the base policy chosen by
+// uthread_init_ex. Every other group schedules its threads with its own FairPolicy, by thread weight.
+// Between the groups, the one with the smallest virtual runtime (its CPU time scaled by UTHREAD_DEFAULT_WEIGHT /
+// shares) runs next, so each group's share of the CPU converges to its share of the total shares however many threads
+// it has. A group that was empty is placed no further back than the group that ran last, so it can't bank CPU time.
+// A group with a quota may use at most quota_ns of CPU time per period_ns: once it used it up its threads are
+// skipped until the next period starts, and a running thread of the group is preempted as soon as the quota runs out
+// (see next_event_ns).
+// The group table has a fixed size, and picking a group is a scan of the groups that were created.
+class GroupPolicy : public SchedulingPolicy {
+public:
+    GroupPolicy();
+
+    void init(SchedulingPolicy* base, long long quantum_ns);
+
+    // Adds a group and returns its id, or -1 if there are UTHREAD_MAX_GROUPS groups already
+    int create(int shares, long long quota_ns, long long period_ns);
+    bool exists(int group) const;
+    // CPU time the group's threads were charged for, in nanoseconds
+    long long usage_ns(int group) const;
+
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    bool can_pick(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+    void charge(Thread* thread, long long ns) override;
+    void on_clock(long long now_ns) override;
+    long long next_event_ns(const Thread* running, long long running_since_ns) const override;
+    void on_quantum(int quantum) override;
+    void on_tick(Thread* thread) override;
+    void on_block(Thread* thread) override;
+    void on_wake(Thread* thread) override;
+    int time_slice(const Thread* thread) const override;
+
+private:
+    struct Group {
+        int shares;
+        long long quota_ns; // 0 for no quota
+        long long period_ns;
+        long long period_start_ns;
+        long long period_usage_ns; // CPU time used in the current period
+        long long usage_ns; // CPU time used overall
+        long long vruntime;
+        FairPolicy fair; // unused for group 0
+        SchedulingPolicy* threads; // fair, or the base policy for group 0
+    };
+
+    SchedulingPolicy* threads_of(int group) const;
+    bool runnable(int group) const;
+    int next_group() const;
+
+    SchedulingPolicy* base;
+    Group groups[UTHREAD_MAX_GROUPS];
+    int count;
+    long long min_vruntime; // virtual runtime of the group picked last
+};
+
+
+#endif //EX2_RESOURCES_GROUPPOLICY_H
@@ -0,0 +1,73 @@
+//
+// Smallest-free-id allocator for thread ids, backed by a hierarchical bitmap.
+//
+
+#include "IdAllocator.h"
+
+#define WORD_BITS 64
+
+IdAllocator::IdAllocator() : size(0) {}
+
+void IdAllocator::init(int capacity)
+{
+    size = capacity;
+    levels.clear();
+    int bits = capacity;
+    do {
+        int words = (bits + WORD_BITS - 1) / WORD_BITS;
+        levels.push_back(std::vector<uint64_t>(words, 0));
+        bits = words;
+    } while (bits > 1);
+
+    for (int id = 0; id < capacity; id++) {
+        set_free(id, true);
+    }
+}
+
+int IdAllocator::capacity() const
+{
+    return size;
+}
+
+int IdAllocator::allocate()
+{
+    if (size == 0 || levels.back()[0] == 0) {
+        return -1;
+    }
+    int index = 0;
+    for (int level = (int) levels.size() - 1; level >= 0; level--) {
+        index = index * WORD_BITS + __builtin_ctzll(levels[level][index]);
+    }
+    set_free(index, false);
+    return index;
+}
+
+void IdAllocator::release(int id)
+{
+    if (id >= 0 && id < size) {
+        set_free(id, true);
+    }
+}
+
+// Updates the id's bit and the summary bits above it, stopping as soon as a summary bit does not change
+void IdAllocator::set_free(int id, bool free)
+{
+    int index = id;
+    for (int level = 0; level < (int) levels.size(); level++) {
+        uint64_t& word = levels[level][index / WORD_BITS];
+        bool was_empty = word == 0;
+        uint64_t bit = (uint64_t) 1 << (index % WORD_BITS);
+        if (free) {
+            word |= bit;
+            if (!was_empty) {
+                return;
+            }
+        } else {
+            word &= ~bit;
+            if (word != 0) {
+                return;
+            }
+        }
+        index /= WORD_BITS;
+    }
+}
@@ -0,0 +1,34 @@
+//
+// Smallest-free-id allocator for thread ids, backed by a hierarchical bitmap.
+//
+
+#ifndef EX2_RESOURCES_IDALLOCATOR_H
+#define EX2_RESOURCES_IDALLOCATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+// Level 0 has one bit per id, set while the id is free. Every level above has one bit per 64-bit word of the level
+// below it, set while that word has any free id. Finding the smallest free id walks down from the single top word
+// using count-trailing-zeros (tzcnt), and freeing or taking an id walks back up, so both are O(log64 capacity).
+class IdAllocator {
+public:
+    IdAllocator();
+
+    // Sizes the bitmap for ids [0, capacity) and marks them all free. Allocates, so call it outside the scheduler.
+    void init(int capacity);
+
+    int capacity() const;
+
+    int allocate(); // takes the smallest free id, -1 if all are taken
+    void release(int id);
+
+private:
+    void set_free(int id, bool free);
+
+    std::vector<std::vector<uint64_t>> levels; // levels[0] is the per-id level, levels.back() is a single word
+    int size;
+};
+
+
+#endif //EX2_RESOURCES_IDALLOCATOR_H
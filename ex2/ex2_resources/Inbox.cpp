@@ -0,0 +1,105 @@
+//
+// Lock-free queue of requests that threads outside the scheduler post to it, see uthread_post_resume.
+//
+
+#include "Inbox.h"
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define INBOX_MASK (UTHREAD_INBOX_CAPACITY - 1)
+
+Inbox::Inbox() : tail(0), head(0), waiting(false), event_fd(-1)
+{
+    for (unsigned int i = 0; i < UTHREAD_INBOX_CAPACITY; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool Inbox::init()
+{
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return event_fd >= 0;
+}
+
+bool Inbox::post(const InboxMessage& message)
+{
+    unsigned int position = tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[position & INBOX_MASK];
+        int lag = (int) (slot->sequence.load(std::memory_order_acquire) - position);
+        if (lag == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            // the slot still holds the message of the previous lap
+            return false;
+        } else {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->message = message;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    // pairs with the fence in wait: either the consumer sees the message, or the producer sees it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) < 0) {
+            // the counter is non-zero already, the consumer wakes up anyway
+        }
+    }
+    return true;
+}
+
+bool Inbox::take(InboxMessage* message)
+{
+    unsigned int position = head.load(std::memory_order_relaxed);
+    Slot& slot = slots[position & INBOX_MASK];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+        return false;
+    }
+    *message = slot.message;
+    slot.sequence.store(position + UTHREAD_INBOX_CAPACITY, std::memory_order_release);
+    head.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool Inbox::peek(InboxMessage* message) const
+{
+    unsigned int position = head.load(std::memory_order_relaxed);
+    const Slot& slot = slots[position & INBOX_MASK];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+        return false;
+    }
+    *message = slot.message;
+    return true;
+}
+
+bool Inbox::empty() const
+{
+    unsigned int position = head.load(std::memory_order_relaxed);
+    return slots[position & INBOX_MASK].sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+bool Inbox::pending() const
+{
+    return tail.load(std::memory_order_relaxed) != head.load(std::memory_order_relaxed);
+}
+
+void Inbox::wait(const struct timespec* timeout, const sigset_t* mask)
+{
+    waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty()) {
+        struct pollfd event = {event_fd, POLLIN, 0};
+        ppoll(&event, 1, timeout, mask);
+    }
+    waiting.store(false, std::memory_order_relaxed);
+    uint64_t count;
+    if (read(event_fd, &count, sizeof(count)) < 0) {
+        // nothing was written, the counter is zero already
+    }
+}
@@ -0,0 +1,69 @@
+//
+// Lock-free queue of requests that threads outside the scheduler post to it, see uthread_post_resume.
+//
+
+#ifndef EX2_RESOURCES_INBOX_H
+#define EX2_RESOURCES_INBOX_H
+
+#include "uthreads.h"
+#include <atomic>
+#include <signal.h>
+#include <time.h>
+
+#define INBOX_RESUME 0
+#define INBOX_SPAWN 1
+
+struct InboxMessage {
+    int kind; // INBOX_RESUME or INBOX_SPAWN
+    int tid; // the thread to resume
+    unsigned int generation; // of tid when the request was posted, a thread that took it later isn't resumed
+    thread_entry_point entry_point; // the thread to spawn
+};
+
+// Bounded multi-producer single-consumer ring. Any thread posts - a foreign pthread or a uthread - and only the
+// scheduler takes the messages out, from inside the scheduler, so there is one consumer at a time: the kernel thread
+// in 1:N mode, the holder of the scheduler lock in M:N mode.
+// A producer claims a slot by moving the tail with a CAS, then publishes its message through the slot's sequence
+// number, so no lock is ever held and a producer that is preempted halfway only holds back the messages behind its own.
+// Neither side allocates, since the scheduler drains the inbox from the timer handler as well - where it leaves the
+// requests it couldn't carry out without allocating for later, see drain_inbox in uthreads.cpp.
+// The consumer sleeps with wait, on an eventfd that post only writes to while it does.
+class Inbox {
+public:
+    Inbox();
+
+    // Creates the eventfd. Returns false if it can't.
+    bool init();
+
+    // Queues the message. Returns false if the inbox is full.
+    bool post(const InboxMessage& message);
+    // Takes the oldest published message out. Returns false if there is none. Consumer only.
+    bool take(InboxMessage* message);
+    // Copies the oldest published message, which stays in. Returns false if there is none. Consumer only.
+    bool peek(InboxMessage* message) const;
+    // Whether no published message waits. Consumer only.
+    bool empty() const;
+    // Whether a message was posted that the consumer hasn't taken yet, published or not. Any thread may ask, the answer
+    // may be out of date by the time it returns.
+    bool pending() const;
+
+    // Sleeps until a message is posted, or for timeout (nullptr for no limit), with the signal mask set to mask as in
+    // ppoll. Returns right away if a message waits already. Consumer only.
+    void wait(const struct timespec* timeout, const sigset_t* mask);
+
+private:
+    struct Slot {
+        // The position the slot is free for, or that position + 1 once its message is published
+        std::atomic<unsigned int> sequence;
+        InboxMessage message;
+    };
+
+    Slot slots[UTHREAD_INBOX_CAPACITY]; // a power of two
+    std::atomic<unsigned int> tail; // next position to claim
+    std::atomic<unsigned int> head; // next position to take, only the consumer moves it
+    std::atomic<bool> waiting; // the consumer sleeps in wait, or is about to
+    int event_fd;
+};
+
+
+#endif //EX2_RESOURCES_INBOX_H
@@ -0,0 +1,140 @@
+//
+// Round robin over a queue per worker, the policy of the M:N mode.
+//
+
+#include "MultiQueuePolicy.h"
+#include "Thread.h"
+
+// The worker of the calling kernel thread, see set_worker. The initial-exec model makes a read a single instruction.
+static thread_local __attribute__((tls_model("initial-exec"))) int current = 0;
+// State of the random placement of the calling kernel thread with scatter, xorshift32
+static thread_local __attribute__((tls_model("initial-exec"))) unsigned int seed = 1;
+
+MultiQueuePolicy::MultiQueuePolicy() : workers(1), migration_cost_ns(0), scatter(false) {}
+
+void MultiQueuePolicy::init(int workers, long long migration_cost_ns, bool scatter)
+{
+    this->workers = workers;
+    this->migration_cost_ns = migration_cost_ns;
+    this->scatter = scatter;
+}
+
+void MultiQueuePolicy::set_worker(int worker)
+{
+    current = worker;
+    seed = worker + 1;
+}
+
+int MultiQueuePolicy::queue_of(const Thread* thread) const
+{
+    if (scatter) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        // the first worker of the affinity from a random one on
+        int first = (int) (seed % (unsigned int) workers);
+        for (int i = 0; i < workers; i++) {
+            int worker = (first + i) % workers;
+            if ((thread->affinity >> worker & 1) != 0) {
+                return worker;
+            }
+        }
+    }
+    int worker = thread->worker >= 0 ? thread->worker : current;
+    if ((thread->affinity >> worker & 1) != 0) {
+        return worker;
+    }
+    int shortest = -1;
+    for (int i = 0; i < workers; i++) {
+        if ((thread->affinity >> i & 1) != 0 && (shortest < 0 || ready[i].size() < ready[shortest].size())) {
+            shortest = i;
+        }
+    }
+    return shortest;
+}
+
+bool MultiQueuePolicy::scatters() const
+{
+    return scatter;
+}
+
+void MultiQueuePolicy::enqueue(Thread* thread)
+{
+    if (thread->worker < 0 || (thread->affinity >> thread->worker & 1) == 0) {
+        thread->worker = queue_of(thread);
+    }
+    ready[thread->worker].push_back(thread);
+}
+
+bool MultiQueuePolicy::may_steal(const Thread* thread, long long now_ns, bool idle) const
+{
+    return (thread->affinity >> current & 1) != 0 && (idle || now_ns - thread->off_cpu_ns >= migration_cost_ns);
+}
+
+int MultiQueuePolicy::steal(int victim, long long now_ns, bool idle)
+{
+    ThreadQueue& from = ready[victim];
+    int count = (from.size() - ready[current].size() + 1) / 2;
+    if (count <= 0) {
+        return 0;
+    }
+    // the first of the last count threads that may be moved, then those from there on
+    Thread* thread = from.back();
+    Thread* first = nullptr;
+    int found = 0;
+    while (thread != nullptr && found < count) {
+        if (may_steal(thread, now_ns, idle)) {
+            first = thread;
+            found++;
+        }
+        thread = thread->prev;
+    }
+    thread = first;
+    while (thread != nullptr) {
+        Thread* next = thread->next;
+        if (may_steal(thread, now_ns, idle)) {
+            from.remove(thread);
+            thread->worker = current;
+            ready[current].push_back(thread);
+        }
+        thread = next;
+    }
+    return found;
+}
+
+bool MultiQueuePolicy::empty(int worker) const
+{
+    return ready[worker].empty();
+}
+
+Thread* MultiQueuePolicy::dequeue_next()
+{
+    return ready[current].pop_front();
+}
+
+void MultiQueuePolicy::remove(Thread* thread)
+{
+    if (thread->worker >= 0) {
+        ready[thread->worker].remove(thread);
+    }
+}
+
+bool MultiQueuePolicy::contains(const Thread* thread) const
+{
+    return thread != nullptr && thread->worker >= 0 && ready[thread->worker].contains(thread);
+}
+
+bool MultiQueuePolicy::can_pick(const Thread* thread) const
+{
+    return thread != nullptr && thread->worker == current && ready[current].contains(thread);
+}
+
+bool MultiQueuePolicy::empty() const
+{
+    return ready[current].empty();
+}
+
+int MultiQueuePolicy::size() const
+{
+    return ready[current].size();
+}
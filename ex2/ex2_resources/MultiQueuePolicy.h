@@ -0,0 +1,71 @@
+//
+// Round robin over a queue per worker, the policy of the M:N mode.
+//
+
+#ifndef EX2_RESOURCES_MULTIQUEUEPOLICY_H
+#define EX2_RESOURCES_MULTIQUEUEPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "ThreadQueue.h"
+#include "uthreads.h"
+
+// Every worker (uthread_options.workers) runs the threads of its own FIFO, round robin. A thread is queued on the
+// worker it last ran on, so it keeps running on the same core with its stack and data in the core's caches; a thread
+// that never ran goes to the worker that spawned it. A thread is only queued on the workers of its affinity
+// (Thread::affinity): if the one it would go to isn't among them, it goes to the one of them with the shortest queue.
+// With scatter set instead, every thread that is queued goes to a random worker of its affinity: placement that
+// ignores cache affinity, as a baseline to measure it against (uthread_options.scatter_threads).
+// A worker whose queue ran empty steals from the others (see steal). dequeue_next, can_pick, empty and size are about
+// the queue of the calling worker, which every worker sets once with set_worker on its own kernel thread.
+// Each queue is guarded by the queue lock of its worker in uthreads.cpp, not by the scheduler lock: the caller holds
+// the lock of every queue a method touches - the one of thread->worker for enqueue, remove and contains, and the ones
+// of the calling worker and the victim for steal. empty(worker) and queue_of only read the other queues' lengths, and
+// may be called without their locks.
+// The queues are ThreadQueues under a lock rather than lock-free Chase-Lev deques: blocking, terminating or moving a
+// thread takes it out of the middle of its queue in O(1), and round robin runs the threads in FIFO order, where a
+// deque would only let the owner and the thieves at its two ends. A thief only tries the victim's lock, and moves on
+// to another victim if it is taken, so stealing never holds up the victim nor the other thieves.
+class MultiQueuePolicy : public SchedulingPolicy {
+public:
+    MultiQueuePolicy();
+
+    // A thread that left the CPU less than migration_cost_ns ago is cache-hot, see steal
+    void init(int workers, long long migration_cost_ns, bool scatter);
+    // The worker of the calling kernel thread
+    void set_worker(int worker);
+    // The worker enqueue puts the thread on: the one it is queued on or last ran on if it may run there, otherwise the
+    // one of its affinity with the shortest queue - or a random one of its affinity with scatter. The caller locks
+    // that queue, and sets thread->worker to it.
+    int queue_of(const Thread* thread) const;
+    // Whether threads are queued on random workers, so that one leaving the CPU doesn't go back to its worker's queue
+    bool scatters() const;
+
+    // Moves threads from the end of the victim's queue - those it would run last - to the end of the queue of the
+    // current worker, in the same order: half the difference in length of the two queues, rounded up, so that they
+    // end up even. Only threads that may run on the current worker are moved, and unless it is idle, only cold ones:
+    // a thread that just left the CPU (now_ns on CLOCK_MONOTONIC) would find its data in the caches of its core, and
+    // the current worker has a thread to run meanwhile. Returns the number of threads moved.
+    int steal(int victim, long long now_ns, bool idle);
+    bool empty(int worker) const;
+
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    // Only a thread in the calling worker's queue may run next on it
+    bool can_pick(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+private:
+    bool may_steal(const Thread* thread, long long now_ns, bool idle) const;
+
+    ThreadQueue ready[UTHREAD_MAX_WORKERS];
+    int workers;
+    long long migration_cost_ns;
+    bool scatter;
+};
+
+
+#endif //EX2_RESOURCES_MULTIQUEUEPOLICY_H
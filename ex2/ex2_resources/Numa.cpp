@@ -0,0 +1,27 @@
+//
+// Placement of memory on NUMA nodes, for the stacks and control blocks of threads, see ThreadPool.
+//
+
+#include "Numa.h"
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int numa_current_node()
+{
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) < 0 || node >= MAX_NUMA_NODES) {
+        return -1;
+    }
+    return (int) node;
+}
+
+bool numa_bind(void* addr, size_t size, int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODES || size == 0) {
+        return true;
+    }
+    unsigned long mask = 1UL << node;
+    // MPOL_PREFERRED rather than MPOL_BIND: a full node spills over to the others instead of failing the page fault
+    return syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &mask, (unsigned long) MAX_NUMA_NODES + 1, 0) == 0;
+}
@@ -0,0 +1,25 @@
+//
+// Placement of memory on NUMA nodes, for the stacks and control blocks of threads, see ThreadPool.
+//
+
+#ifndef EX2_RESOURCES_NUMA_H
+#define EX2_RESOURCES_NUMA_H
+
+#include <stddef.h>
+
+// Nodes at or above this are treated as unknown
+#define MAX_NUMA_NODES 64
+
+// Both are thin wrappers of the system calls (getcpu, mbind) rather than of libnuma, so the library keeps no
+// dependency of its own. A kernel without NUMA support fails the calls, and everything then behaves as if on node -1.
+
+// The node of the CPU the calling kernel thread runs on, -1 if it is unknown
+int numa_current_node();
+
+// Has the pages of [addr, addr + size) that are not touched yet allocated on node when they are, as long as it has free
+// memory, instead of on the node of whoever touches them first. addr must be page aligned. No effect for node -1.
+// Returns false if the kernel refused.
+bool numa_bind(void* addr, size_t size, int node);
+
+
+#endif //EX2_RESOURCES_NUMA_H
@@ -0,0 +1,142 @@
+//
+// Intrusive pairing heap of threads, used by the policies that run the thread with the smallest key first.
+//
+
+#include "PairingHeap.h"
+#include "Thread.h"
+
+PairingHeap::PairingHeap(Less less) : less(less), root(nullptr), count(0) {}
+
+bool PairingHeap::empty() const
+{
+    return root == nullptr;
+}
+
+int PairingHeap::size() const
+{
+    return count;
+}
+
+Thread* PairingHeap::min() const
+{
+    return root;
+}
+
+bool PairingHeap::contains(const Thread* thread) const
+{
+    return thread != nullptr && thread->heap == this;
+}
+
+void PairingHeap::insert(Thread* thread)
+{
+    thread->heap = this;
+    thread->heap_child = nullptr;
+    thread->heap_next = nullptr;
+    thread->heap_prev = nullptr;
+    root = meld(root, thread);
+    count++;
+}
+
+Thread* PairingHeap::pop_min()
+{
+    Thread* thread = root;
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+void PairingHeap::remove(Thread* thread)
+{
+    if (!contains(thread)) {
+        return;
+    }
+    Thread* children = merge_pairs(thread->heap_child);
+    if (thread == root) {
+        root = children;
+    } else {
+        detach(thread);
+        root = meld(root, children);
+    }
+    if (root != nullptr) {
+        root->heap_prev = nullptr;
+    }
+    thread->heap = nullptr;
+    thread->heap_child = nullptr;
+    thread->heap_next = nullptr;
+    thread->heap_prev = nullptr;
+    count--;
+}
+
+// Links two roots (either may be nullptr) and returns the new root
+Thread* PairingHeap::meld(Thread* a, Thread* b)
+{
+    if (a == nullptr) {
+        return b;
+    }
+    if (b == nullptr) {
+        return a;
+    }
+    if (less(b, a)) {
+        Thread* t = a;
+        a = b;
+        b = t;
+    }
+    // b becomes the first child of a
+    b->heap_prev = a;
+    b->heap_next = a->heap_child;
+    if (a->heap_child != nullptr) {
+        a->heap_child->heap_prev = b;
+    }
+    a->heap_child = b;
+    a->heap_next = nullptr;
+    a->heap_prev = nullptr;
+    return a;
+}
+
+// Standard two-pass merge of a list of siblings: meld them in pairs left to right, then meld the pairs right to left
+Thread* PairingHeap::merge_pairs(Thread* first)
+{
+    if (first == nullptr) {
+        return nullptr;
+    }
+    // first pass, the melded pairs are chained back to front through heap_prev
+    Thread* pairs = nullptr;
+    while (first != nullptr) {
+        Thread* a = first;
+        Thread* b = a->heap_next;
+        first = b != nullptr ? b->heap_next : nullptr;
+        a->heap_next = nullptr;
+        a->heap_prev = nullptr;
+        if (b != nullptr) {
+            b->heap_next = nullptr;
+            b->heap_prev = nullptr;
+        }
+        Thread* pair = meld(a, b);
+        pair->heap_prev = pairs;
+        pairs = pair;
+    }
+    // second pass
+    Thread* result = nullptr;
+    while (pairs != nullptr) {
+        Thread* pair = pairs;
+        pairs = pair->heap_prev;
+        pair->heap_prev = nullptr;
+        result = meld(result, pair);
+    }
+    return result;
+}
+
+// Unlinks a non-root thread (with its children) from its parent or siblings
+void PairingHeap::detach(Thread* thread)
+{
+    Thread* prev = thread->heap_prev;
+    if (prev->heap_child == thread) {
+        prev->heap_child = thread->heap_next;
+    } else {
+        prev->heap_next = thread->heap_next;
+    }
+    if (thread->heap_next != nullptr) {
+        thread->heap_next->heap_prev = prev;
+    }
+}
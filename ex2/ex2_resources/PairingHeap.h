@@ -0,0 +1,41 @@
+//
+// Intrusive pairing heap of threads, used by the policies that run the thread with the smallest key first.
+//
+
+#ifndef EX2_RESOURCES_PAIRINGHEAP_H
+#define EX2_RESOURCES_PAIRINGHEAP_H
+
+class Thread;
+
+// The links live inside Thread (heap_child, heap_next, heap_prev), so nothing is ever allocated. heap_prev points to
+// the previous sibling, or to the parent for a first child. The order is given by the less function passed to the
+// constructor, which must be a strict weak order and must not change for a thread while it is in the heap.
+// insert and min are O(1), pop_min and remove are O(log n) amortized.
+// A thread is in at most one heap at a time, and never in a heap and a ThreadQueue at once.
+class PairingHeap {
+public:
+    typedef bool (*Less)(const Thread* a, const Thread* b);
+
+    explicit PairingHeap(Less less);
+
+    bool empty() const;
+    int size() const;
+    Thread* min() const;
+    bool contains(const Thread* thread) const;
+
+    void insert(Thread* thread);
+    Thread* pop_min(); // returns nullptr if the heap is empty
+    void remove(Thread* thread); // no effect if the thread is not in this heap
+
+private:
+    Thread* meld(Thread* a, Thread* b);
+    Thread* merge_pairs(Thread* first);
+    void detach(Thread* thread);
+
+    Less less;
+    Thread* root;
+    int count;
+};
+
+
+#endif //EX2_RESOURCES_PAIRINGHEAP_H
@@ -0,0 +1,113 @@
+//
+// The periodic timer that drives preemption, with a choice of clocks.
+//
+
+#include "PreemptionTimer.h"
+#include "uthreads.h"
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+PreemptionTimer::PreemptionTimer() : timer_kind(UTHREAD_TIMER_VIRTUAL), period(0), running(false), created(false),
+                                     timer_id() {}
+
+int PreemptionTimer::start(int kind, int period_usecs, int signo)
+{
+    stop();
+    timer_kind = kind;
+    period = period_usecs;
+
+    if (kind != UTHREAD_TIMER_VIRTUAL) {
+        clockid_t clock;
+        if (kind == UTHREAD_TIMER_THREAD_CPU) {
+            clock = CLOCK_THREAD_CPUTIME_ID;
+        } else if (kind == UTHREAD_TIMER_MONOTONIC) {
+            clock = CLOCK_MONOTONIC;
+        } else {
+            return -1;
+        }
+
+        struct sigevent event = {};
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = signo;
+        event.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+        if (timer_create(clock, &event, &timer_id) == -1) {
+            return -1;
+        }
+        created = true;
+    }
+
+    if (arm() == -1) {
+        stop();
+        return -1;
+    }
+    return 0;
+}
+
+void PreemptionTimer::stop()
+{
+    disarm();
+    if (created) {
+        timer_delete(timer_id);
+        created = false;
+    }
+}
+
+int PreemptionTimer::arm()
+{
+    if (set(period) == -1) {
+        return -1;
+    }
+    running = true;
+    return 0;
+}
+
+int PreemptionTimer::disarm()
+{
+    if (!running) {
+        return 0;
+    }
+    running = false;
+    return set(0);
+}
+
+bool PreemptionTimer::armed() const
+{
+    return running;
+}
+
+int PreemptionTimer::set_period(int period_usecs)
+{
+    period = period_usecs;
+    return running ? set(period) : 0;
+}
+
+int PreemptionTimer::kind() const
+{
+    return timer_kind;
+}
+
+// Sets the first expiration and the interval to period_usecs, 0 stops the timer
+int PreemptionTimer::set(long period_usecs)
+{
+    if (timer_kind == UTHREAD_TIMER_VIRTUAL) {
+        struct itimerval timer;
+        timer.it_value.tv_sec = period_usecs / 1000000;
+        timer.it_value.tv_usec = period_usecs % 1000000;
+        timer.it_interval = timer.it_value;
+        return setitimer(ITIMER_VIRTUAL, &timer, nullptr) == 0 ? 0 : -1;
+    }
+    if (!created) {
+        return -1;
+    }
+    struct itimerspec spec;
+    spec.it_value.tv_sec = period_usecs / 1000000;
+    spec.it_value.tv_nsec = period_usecs % 1000000 * 1000L;
+    spec.it_interval = spec.it_value;
+    return timer_settime(timer_id, 0, &spec, nullptr) == 0 ? 0 : -1;
+}
@@ -0,0 +1,47 @@
+//
+// The periodic timer that drives preemption, with a choice of clocks.
+//
+
+#ifndef EX2_RESOURCES_PREEMPTIONTIMER_H
+#define EX2_RESOURCES_PREEMPTIONTIMER_H
+
+#include <time.h>
+
+// The timer is armed once and then fires every period on its own - the scheduler never re-arms it on a switch, it
+// only resets the running thread's budget of ticks (see timer_handler in uthreads.cpp). In tickless mode it is disarmed
+// while there is nothing to preempt for, and with an adaptive quantum its period follows the quantum.
+// Backends (UTHREAD_TIMER_* in uthreads.h):
+//   VIRTUAL    - setitimer(ITIMER_VIRTUAL), CPU time of the whole process, delivered to any of its kernel threads
+//   THREAD_CPU - timer_create(CLOCK_THREAD_CPUTIME_ID), CPU time of the kernel thread that starts the timer, and
+//                delivered to that kernel thread only (SIGEV_THREAD_ID)
+//   MONOTONIC  - timer_create(CLOCK_MONOTONIC), wall-clock time, so a thread blocked in a system call still loses
+//                the CPU at the end of its quantum; delivered to the starting kernel thread
+class PreemptionTimer {
+public:
+    PreemptionTimer();
+
+    // Fires signo every period_usecs. Returns 0 on success, -1 if the timer can't be set up.
+    int start(int kind, int period_usecs, int signo);
+    void stop();
+
+    // Stops and restarts the signals of a started timer, keeping its clock and period. arm starts a full period.
+    int arm();
+    int disarm();
+    bool armed() const;
+    // Changes the period. An armed timer restarts with a full period of the new length.
+    int set_period(int period_usecs);
+
+    int kind() const;
+
+private:
+    int set(long period_usecs);
+
+    int timer_kind;
+    long period;
+    bool running;
+    bool created; // whether timer_id holds a timer_create timer
+    timer_t timer_id;
+};
+
+
+#endif //EX2_RESOURCES_PREEMPTIONTIMER_H
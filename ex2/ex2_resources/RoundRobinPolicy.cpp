@@ -0,0 +1,35 @@
+//
+// Round robin: the default scheduling policy.
+//
+
+#include "RoundRobinPolicy.h"
+
+void RoundRobinPolicy::enqueue(Thread* thread)
+{
+    ready.push_back(thread);
+}
+
+Thread* RoundRobinPolicy::dequeue_next()
+{
+    return ready.pop_front();
+}
+
+void RoundRobinPolicy::remove(Thread* thread)
+{
+    ready.remove(thread);
+}
+
+bool RoundRobinPolicy::contains(const Thread* thread) const
+{
+    return ready.contains(thread);
+}
+
+bool RoundRobinPolicy::empty() const
+{
+    return ready.empty();
+}
+
+int RoundRobinPolicy::size() const
+{
+    return ready.size();
+}
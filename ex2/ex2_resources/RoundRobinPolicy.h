@@ -0,0 +1,27 @@
+//
+// Round robin: the default scheduling policy.
+//
+
+#ifndef EX2_RESOURCES_ROUNDROBINPOLICY_H
+#define EX2_RESOURCES_ROUNDROBINPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "ThreadQueue.h"
+
+// One FIFO of ready threads, every thread gets the same quantum
+class RoundRobinPolicy : public SchedulingPolicy {
+public:
+    void enqueue(Thread* thread) override;
+    Thread* dequeue_next() override;
+    void remove(Thread* thread) override;
+
+    bool contains(const Thread* thread) const override;
+    bool empty() const override;
+    int size() const override;
+
+private:
+    ThreadQueue ready;
+};
+
+
+#endif //EX2_RESOURCES_ROUNDROBINPOLICY_H
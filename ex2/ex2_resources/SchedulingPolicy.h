@@ -0,0 +1,59 @@
+//
+// Interface between the scheduler in uthreads.cpp and the policy that decides which ready thread runs next.
+//
+
+#ifndef EX2_RESOURCES_SCHEDULINGPOLICY_H
+#define EX2_RESOURCES_SCHEDULINGPOLICY_H
+
+#include <climits>
+
+class Thread;
+
+// The policy owns the READY threads: uthreads.cpp hands every thread that becomes ready to enqueue and asks
+// dequeue_next for the thread to run at the start of every quantum. The hooks tell the policy why the running thread
+// leaves the CPU, so it can adjust priorities before the thread is queued again.
+// Every method is called inside the scheduler (see enter_scheduler), possibly from the SIGVTALRM handler, so none
+// of them may allocate, block or call into the library.
+class SchedulingPolicy {
+public:
+    virtual ~SchedulingPolicy() {}
+
+    // A thread becomes ready: spawned, resumed, woken up or preempted
+    virtual void enqueue(Thread* thread) = 0;
+    // Takes the thread to run in the next quantum out of the ready threads, nullptr if there is none
+    virtual Thread* dequeue_next() = 0;
+    // Takes a ready thread out, because it is blocked or terminated by another thread. No effect if it is not ready.
+    virtual void remove(Thread* thread) = 0;
+
+    virtual bool contains(const Thread* thread) const = 0;
+    // Whether the ready thread may run next instead of the one dequeue_next would pick: it is held, isn't held back
+    // (throttled) and no class above it has a thread ready. The scheduler then takes it out with remove.
+    virtual bool can_pick(const Thread* thread) const { return contains(thread); }
+    virtual bool empty() const = 0;
+    virtual int size() const = 0;
+
+    // The running thread ran for ns nanoseconds since it was switched to or last charged. Called before the hooks below
+    // when it leaves the CPU, and possibly in the middle of its quantum.
+    virtual void charge(Thread* /*thread*/, long long /*ns*/) {}
+    // The scheduler is about to pick a thread, at now_ns on CLOCK_MONOTONIC. Threads waiting for a point in time
+    // become ready here.
+    virtual void on_clock(long long /*now_ns*/) {}
+    // When the scheduler should run again (CLOCK_MONOTONIC), regardless of the quantum: LLONG_MAX for never, 0 for
+    // right away. running is nullptr while nothing runs, otherwise it was charged up to running_since_ns.
+    virtual long long next_event_ns(const Thread* /*running*/, long long /*running_since_ns*/) const { return LLONG_MAX; }
+    // A new quantum starts, idle ones included. Called before dequeue_next.
+    virtual void on_quantum(int /*quantum*/) {}
+    // The running thread used up its quantum, it is enqueued right after. Not called when the thread is preempted
+    // before the end of its quantum.
+    virtual void on_tick(Thread* /*thread*/) {}
+    // The running thread blocks or sleeps before the end of its quantum
+    virtual void on_block(Thread* /*thread*/) {}
+    // A blocked or sleeping thread becomes ready, it is enqueued right after
+    virtual void on_wake(Thread* /*thread*/) {}
+
+    // Length of the thread's next quantum, in quantums of uthread_init_ex
+    virtual int time_slice(const Thread* /*thread*/) const { return 1; }
+};
+
+
+#endif //EX2_RESOURCES_SCHEDULINGPOLICY_H
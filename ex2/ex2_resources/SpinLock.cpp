@@ -0,0 +1,36 @@
+//
+// Test-and-test-and-set lock of the scheduler and of the run queues in M:N mode.
+//
+
+#include "SpinLock.h"
+#include <sched.h>
+
+// Spins before a waiting worker gives its core up with sched_yield
+#define SPINS_BEFORE_YIELD 128
+
+SpinLock::SpinLock() : locked(0) {}
+
+void SpinLock::lock()
+{
+    int spins = 0;
+    while (locked.exchange(1, std::memory_order_acquire) != 0) {
+        while (locked.load(std::memory_order_relaxed) != 0) {
+            if (++spins < SPINS_BEFORE_YIELD) {
+                __builtin_ia32_pause();
+            } else {
+                spins = 0;
+                sched_yield();
+            }
+        }
+    }
+}
+
+bool SpinLock::try_lock()
+{
+    return locked.load(std::memory_order_relaxed) == 0 && locked.exchange(1, std::memory_order_acquire) == 0;
+}
+
+void SpinLock::unlock()
+{
+    locked.store(0, std::memory_order_release);
+}
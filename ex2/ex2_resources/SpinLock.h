@@ -0,0 +1,28 @@
+//
+// Test-and-test-and-set lock of the scheduler and of the run queues in M:N mode.
+//
+
+#ifndef EX2_RESOURCES_SPINLOCK_H
+#define EX2_RESOURCES_SPINLOCK_H
+
+#include <atomic>
+
+// The scheduler holds its locks for a few hundred nanoseconds, across a context switch, and takes them from the
+// SIGVTALRM handler, so a mutex is no option: it can't be released by a thread other than its owner, and isn't
+// async-signal-safe. The lock isn't owned by a kernel thread, whoever holds the scheduler releases it. A worker that
+// waits spins on a plain load, and yields its core after a while, in case the holder was preempted by the kernel.
+class SpinLock {
+public:
+    SpinLock();
+
+    void lock();
+    // Takes the lock if it is free. Returns whether it did.
+    bool try_lock();
+    void unlock();
+
+private:
+    std::atomic<int> locked;
+};
+
+
+#endif //EX2_RESOURCES_SPINLOCK_H
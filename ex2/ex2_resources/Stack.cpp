@@ -0,0 +1,65 @@
+//
+// A thread's stack: its own anonymous mapping with a PROT_NONE guard page below it.
+//
+
+#include "Stack.h"
+#include "Numa.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t page_size()
+{
+    static size_t size = (size_t) sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+Stack::Stack() : mapping(nullptr), mapping_size(0) {}
+
+bool Stack::allocate(size_t size, int node)
+{
+    size_t page = page_size();
+    size_t usable = (size + page - 1) & ~(page - 1);
+    void* p = mmap(nullptr, usable + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    if (mprotect(p, page, PROT_NONE) == -1) {
+        munmap(p, usable + page);
+        return false;
+    }
+    // before anything touches the stack, best effort: memory on another node is only slower
+    numa_bind((char*) p + page, usable, node);
+    mapping = (char*) p;
+    mapping_size = usable + page;
+    return true;
+}
+
+void Stack::release()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+}
+
+bool Stack::allocated() const
+{
+    return mapping != nullptr;
+}
+
+char* Stack::top() const
+{
+    return mapping + mapping_size;
+}
+
+size_t Stack::size() const
+{
+    return mapping_size == 0 ? 0 : mapping_size - page_size();
+}
+
+bool Stack::is_guard(const void* addr) const
+{
+    const char* p = (const char*) addr;
+    return mapping != nullptr && p >= mapping && p < mapping + page_size();
+}
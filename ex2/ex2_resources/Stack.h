@@ -0,0 +1,33 @@
+//
+// A thread's stack: its own anonymous mapping with a PROT_NONE guard page below it.
+//
+
+#ifndef EX2_RESOURCES_STACK_H
+#define EX2_RESOURCES_STACK_H
+
+#include <stddef.h>
+
+// Stacks grow down, so running off the end of one hits the guard page and faults (see the SIGSEGV handler in
+// uthreads.cpp) instead of silently overwriting whatever was allocated below it.
+class Stack {
+public:
+    Stack();
+
+    // Maps size usable bytes, rounded up to whole pages, plus the guard page. The pages are placed on NUMA node node
+    // (see numa_bind) as far as the kernel can, -1 leaves that to whoever touches them first. Returns false if mmap
+    // fails.
+    bool allocate(size_t size, int node = -1);
+    void release(); // no effect if nothing is mapped
+
+    bool allocated() const;
+    char* top() const; // the highest address, where an empty stack starts
+    size_t size() const; // usable bytes
+    bool is_guard(const void* addr) const; // whether addr is in the guard page
+
+private:
+    char* mapping; // start of the mapping, i.e. of the guard page
+    size_t mapping_size;
+};
+
+
+#endif //EX2_RESOURCES_STACK_H
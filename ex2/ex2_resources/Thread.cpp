@@ -3,70 +3,207 @@
 //
 
 #include "Thread.h"
-#include <setjmp.h>
-#include <signal.h>
 
-// Code from demo_jmp.c
 #ifdef __x86_64__
 /* code for 64 bit Intel arch */
 
 typedef unsigned long address_t;
-#define JB_SP 6
-#define JB_PC 7
 
-/* A translation is required when using an address of a variable.
-   Use this as a black box in your code. */
-address_t translate_address(address_t addr)
-{
-    address_t ret;
-    asm volatile("xor    %%fs:0x30,%0\n"
-        "rol    $0x11,%0\n"
-                 : "=g" (ret)
-                 : "0" (addr));
-    return ret;
-}
+// context_switch(from = rdi, to = rsi)
+// Pushes the callee-saved registers on the current stack, stores the stack pointer in from->sp, loads to->sp and
+// pops the registers of the target thread. The final ret lands wherever the target thread called context_switch
+// from (or in thread_bootstrap for a thread that never ran). Caller-saved registers are already spilled by the
+// compiler at the call site, so this is the whole switch - no syscalls, no signal mask.
+// context_switch_fp(from, to) also stores MXCSR and the x87 control word in from and loads the ones of to, after the
+// stack switch: ldmxcsr costs more than the rest of the switch, so only threads that need it pay for it.
+// thread_bootstrap loads initial_fp_control before the thread's first instruction, whichever context it was switched
+// to from: the timer handler runs with the kernel's default control state.
+asm(R"(
+    .text
+    .globl context_switch
+    .type context_switch, @function
+context_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    movq %rsp, (%rdi)
+    movq (%rsi), %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size context_switch, .-context_switch
 
-#else
-///* code for 32 bit Intel arch */
-//
-//typedef unsigned int address_t;
-//#define JB_SP 4
-//#define JB_PC 5
-//
-//
-///* A translation is required when using an address of a variable.
-//   Use this as a black box in your code. */
-//address_t translate_address(address_t addr)
-//{
-//    address_t ret;
-//    asm volatile("xor    %%gs:0x18,%0\n"
-//                 "rol    $0x9,%0\n"
-//            : "=g" (ret)
-//            : "0" (addr));
-//    return ret;
-//}
+    .globl context_switch_fp
+    .type context_switch_fp, @function
+context_switch_fp:
+    stmxcsr 8(%rdi)
+    fnstcw 12(%rdi)
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    movq %rsp, (%rdi)
+    movq (%rsi), %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ldmxcsr 8(%rsi)
+    fldcw 12(%rsi)
+    ret
+    .size context_switch_fp, .-context_switch_fp
+
+    .globl save_fp_control
+    .type save_fp_control, @function
+save_fp_control:
+    stmxcsr 8(%rdi)
+    fnstcw 12(%rdi)
+    ret
+    .size save_fp_control, .-save_fp_control
+
+    .globl load_fp_control
+    .type load_fp_control, @function
+load_fp_control:
+    ldmxcsr 8(%rdi)
+    fldcw 12(%rdi)
+    ret
+    .size load_fp_control, .-load_fp_control
 
+    .globl thread_bootstrap
+    .type thread_bootstrap, @function
+thread_bootstrap:
+    movq initial_fp_control@GOTPCREL(%rip), %rax
+    ldmxcsr 8(%rax)
+    fldcw 12(%rax)
+    movq %r12, %rdi
+    call thread_main
+    ud2
+    .size thread_bootstrap, .-thread_bootstrap
+)");
 
+// Number of registers pushed by context_switch
+#define SAVED_REGS 6
+// Index of r12 in the frame popped by context_switch (r15, r14, r13, r12, rbx, rbp)
+#define FRAME_R12 3
+
+#else
+#error "uthreads context switch is implemented for x86-64 only"
 #endif
 
+extern "C" void thread_bootstrap();
+
+// defined in uthreads.cpp
+extern "C" void thread_main(Thread* self);
+
+Context initial_fp_control = {};
+
 //Default constructor
 Thread::Thread()
 {
-    thread_id = 0;
+    reset_state(0, nullptr);
+    node = -1;
+    context.sp = nullptr; // the main thread runs on the process stack, its context is saved on the first switch
+}
+
+void Thread::reset_state(int thread_id, thread_entry_point entry_point_func)
+{
+    this->thread_id = thread_id;
+    this->entry_point_func = entry_point_func;
     state = State::READY;
     total_run_time = 0;
-    quantums_to_sleep = 0;
-    sigemptyset(&env->__saved_mask); // taken from demo_jmp.c
+    wake_quantum = 0;
+    priority = 0;
+    boost_epoch = 0;
+    run_time_ns = 0;
+    quantum_usecs = 0;
+    weight = UTHREAD_DEFAULT_WEIGHT;
+    vruntime = 0;
+    group = 0;
+    latency_critical = false;
+    fp_env = false;
+    worker = -1;
+    on_cpu = false;
+    affinity = ~0ULL;
+    last_worker = -1;
+    migrations = 0;
+    off_cpu_ns = 0;
+    dl_runtime_ns = 0;
+    dl_deadline_ns = 0;
+    dl_period_ns = 0;
+    dl_release_ns = 0;
+    dl_budget_ns = 0;
+    dl_done = false;
+    dl_misses = 0;
+    context.mxcsr = initial_fp_control.mxcsr;
+    context.fpu_cw = initial_fp_control.fpu_cw;
+    next = nullptr;
+    prev = nullptr;
+    queue = nullptr;
+    heap = nullptr;
+    heap_child = nullptr;
+    heap_next = nullptr;
+    heap_prev = nullptr;
+    sleep_next = nullptr;
+    sleep_pprev = nullptr;
+}
+
+bool Thread::stack_fits(size_t stack_size) const
+{
+    // a recycled stack is kept if it is big enough without wasting more than half of it
+    size_t bytes = stack_size + SIGNAL_FRAME_RESERVE;
+    return stack.allocated() && stack.size() >= bytes && stack.size() < 2 * bytes;
+}
+
+bool Thread::prepare(int thread_id, thread_entry_point entry_point_func, size_t stack_size)
+{
+    if (stack.allocated() && !stack_fits(stack_size)) {
+        stack.release();
+    }
+    if (!stack.allocated() && !stack.allocate(stack_size + SIGNAL_FRAME_RESERVE, node)) {
+        return false;
+    }
+
+    reset_state(thread_id, entry_point_func);
+
+    // Build the frame context_switch expects to pop: the saved registers and a return address pointing to
+    // thread_bootstrap. The stack top is 16 byte aligned so that thread_main is entered with the ABI alignment.
+    address_t top = (address_t) stack.top() & ~(address_t) 15;
+    address_t* sp = (address_t*) top;
+    *--sp = (address_t) thread_bootstrap;
+    for (int i = 0; i < SAVED_REGS; i++) {
+        *--sp = 0;
+    }
+    sp[FRAME_R12] = (address_t) this;
+    context.sp = sp;
+    return true;
 }
 
-Thread::Thread(int thread_id, thread_entry_point entry_point_func)  : thread_id(thread_id), state(State::READY),
-                                                                      entry_point_func(entry_point_func), total_run_time(0), quantums_to_sleep(0){
-    // ===========          CODE FROM demo_jmp.c  =============
-
-    address_t sp = (address_t) stack + STACK_SIZE - sizeof(address_t);
-    address_t pc = (address_t) entry_point_func;
-    sigsetjmp(env, 1);
-    (env->__jmpbuf)[JB_SP] = translate_address(sp);
-    (env->__jmpbuf)[JB_PC] = translate_address(pc);
-    sigemptyset(&env->__saved_mask);
-}
\ No newline at end of file
+void prepare_context(Context* context, char* stack_top, void (*entry)())
+{
+    // the padding word leaves entry with the stack alignment of a called function
+    address_t* sp = (address_t*) ((address_t) stack_top & ~(address_t) 15);
+    *--sp = 0;
+    *--sp = (address_t) entry;
+    for (int i = 0; i < SAVED_REGS; i++) {
+        *--sp = 0;
+    }
+    context->sp = sp;
+    context->mxcsr = initial_fp_control.mxcsr;
+    context->fpu_cw = initial_fp_control.fpu_cw;
+}
+
+Thread::~Thread()
+{
+    stack.release();
+}
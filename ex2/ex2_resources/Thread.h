@@ -2,13 +2,16 @@
 // Created by skche on 04/06/2024.
 //
 #include "uthreads.h"
-#include <csetjmp>
+#include "ThreadQueue.h"
+#include "TimerWheel.h"
+#include "PairingHeap.h"
+#include "Stack.h"
 #include <stdio.h>
-#include <setjmp.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <stdbool.h>
+#include <atomic>
 
 
 #ifndef EX2_RESOURCES_THREAD_H
@@ -35,6 +38,40 @@ enum State {
     READY
 };
 
+// Preemption delivers SIGVTALRM on the running thread's stack, and the kernel's signal frame alone takes several KB on
+// machines with AVX-512 state. Every stack gets room for it on top of the size the user asked for.
+#define SIGNAL_FRAME_RESERVE 8192
+
+// Saved execution context of a thread that is not running.
+// Only the stack pointer is kept here: context_switch pushes the callee-saved registers (rbx, rbp, r12-r15) and the
+// return address onto the thread's own stack before saving sp, so nothing else has to be copied on a switch.
+// The floating-point control state (MXCSR and the x87 control word: rounding mode, exception masks) is callee-saved
+// in the ABI as well, but only context_switch_fp keeps it, for the threads that change it (Thread::fp_env). The vector
+// and x87 registers themselves are caller-saved, so the compiler spills them around the call, and a preempted thread
+// gets its whole extended state back from the kernel's signal frame - no switch ever needs an xsave.
+// The signal mask is NOT part of the context - it belongs to the kernel thread and is handled by the library API.
+struct Context {
+    void* sp;
+    unsigned int mxcsr; // at offset 8, see context_switch_fp
+    unsigned short fpu_cw; // at offset 12
+};
+
+// Floating-point control state threads start with: the process' one when uthread_init_ex saved it here
+extern Context initial_fp_control;
+
+// Saves the running context into from and resumes to. Returns when someone switches back to from.
+extern "C" void context_switch(Context* from, Context* to);
+// Same as context_switch, and saves the floating-point control state into from and loads the one of to
+extern "C" void context_switch_fp(Context* from, Context* to);
+// Saves the current floating-point control state into context
+extern "C" void save_fp_control(Context* context);
+// Loads the floating-point control state saved in context
+extern "C" void load_fp_control(const Context* context);
+// Makes context start entry on the stack below stack_top the next time it is switched to. entry must not return.
+void prepare_context(Context* context, char* stack_top, void (*entry)());
+
+// The control block only holds scheduler state - the stack is mapped separately (see Stack.h), so Thread objects are
+// small and an overflowing stack can no longer run into them.
 class Thread {
 public:
 
@@ -43,14 +80,69 @@ public:
     thread_entry_point entry_point_func; // thread's entry point function defined in uthreads.h
 
     Thread(); // default constructor
-    Thread(int thread_id, thread_entry_point entry_point_func);
+    ~Thread();
+
+    // (Re)initializes the thread to start at entry_point_func, on a stack of at least stack_size usable bytes.
+    // A stack left from a previous use is kept when it fits, a new one goes on the thread's node. Returns false if a
+    // new stack could not be mapped.
+    bool prepare(int thread_id, thread_entry_point entry_point_func, size_t stack_size);
+    // Whether prepare keeps the thread's stack for stack_size, and so maps nothing
+    bool stack_fits(size_t stack_size) const;
 
 
     int total_run_time; // overall time for the thread to run
-    int quantums_to_sleep; //total time for thread to sleep
+    int wake_quantum; // quantum at which a sleeping thread wakes up, 0 when it is not sleeping
+    int priority; // feedback queue level, 0 is the highest (see FeedbackQueue.h)
+    int boost_epoch; // FeedbackPolicy boosts seen by the thread when it left the ready queue
+
+    long long run_time_ns; // overall time the thread spent RUNNING, in nanoseconds
+    int quantum_usecs; // the thread's own quantum (uthread_set_quantum), 0 for the default one
+    int weight; // relative CPU share under FairPolicy
+    long long vruntime; // FairPolicy virtual runtime: run time in nanoseconds, scaled by UTHREAD_DEFAULT_WEIGHT / weight
+    int group; // GroupPolicy group, 0 for the default group
+    bool latency_critical; // preempts the running thread when it wakes up (uthread_attr.latency_critical)
+    bool fp_env; // keeps its own floating-point control state across switches (uthread_attr.fp_env)
+    int worker; // worker the thread runs or is queued on, or last ran on (uthread_options.workers), -1 before that
+    // A worker runs on the thread's stack: it is RUNNING, or still switching away from it (see finish_switch)
+    std::atomic<bool> on_cpu;
+    unsigned long long affinity; // bit i set if the thread may run on worker i (uthread_set_affinity)
+    int last_worker; // worker the thread last ran on, -1 before it ran
+    int migrations; // switches to the thread on another worker than the one it last ran on
+    long long off_cpu_ns; // when the thread last left the CPU, 0 before it ran, see MultiQueuePolicy::steal
+    int node; // NUMA node the control block and the stack were placed on, -1 if unknown (see ThreadPool)
+
+    // DeadlinePolicy parameters and current job, in CLOCK_MONOTONIC nanoseconds. dl_period_ns is 0 for a thread
+    // without a deadline.
+    long long dl_runtime_ns;
+    long long dl_deadline_ns; // relative to the release
+    long long dl_period_ns;
+    long long dl_release_ns; // release of the current job
+    long long dl_budget_ns; // runtime left to the current job
+    bool dl_done; // the current job ended (uthread_wait_period)
+    int dl_misses; // jobs that were not done by their deadline
+
+    Context context; // thread's saved registers and SP while it is not running
+
+    // links of the ThreadQueue the thread is currently in (nullptr when it is in none)
+    Thread* next;
+    Thread* prev;
+    ThreadQueue* queue;
+
+    // links of the PairingHeap the thread is currently in (heap is nullptr when it is in none)
+    PairingHeap* heap;
+    Thread* heap_child;
+    Thread* heap_next;
+    Thread* heap_prev;
+
+    // links of the TimerWheel slot the thread is filed in while it sleeps
+    Thread* sleep_next;
+    Thread** sleep_pprev;
+
+    Stack stack; // thread's stack, not allocated for the main thread which runs on the process stack
 
-    sigjmp_buf env; // thread's environment data, including PC and SP, also the signal mask when declared
-    char stack[STACK_SIZE]; // thread's stack
+private:
+    // Resets everything but the node, the stack and the saved stack pointer, for the constructor and prepare
+    void reset_state(int thread_id, thread_entry_point entry_point_func);
 };
 
 
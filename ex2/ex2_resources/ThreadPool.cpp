@@ -0,0 +1,112 @@
+//
+// Free list of Thread control blocks together with their stacks.
+//
+
+#include "ThreadPool.h"
+#include "Thread.h"
+#include <new>
+#include <sys/mman.h>
+
+#define SLAB_BYTES (64 * 1024)
+
+ThreadPool::ThreadPool()
+{
+    for (int node = 0; node < MAX_NUMA_NODES; node++) {
+        slab[node] = nullptr;
+        slab_left[node] = 0;
+    }
+}
+
+Thread* ThreadPool::create(int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODES) {
+        return new Thread();
+    }
+    if (slab_left[node] == 0) {
+        void* p = mmap(nullptr, SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+        numa_bind(p, SLAB_BYTES, node);
+        slab[node] = (char*) p;
+        slab_left[node] = SLAB_BYTES / sizeof(Thread);
+    }
+    // slab threads are never deleted, they stay in the pool for the life of the process
+    Thread* thread = new (slab[node]) Thread();
+    slab[node] += sizeof(Thread);
+    slab_left[node]--;
+    thread->node = node;
+    return thread;
+}
+
+bool ThreadPool::reserve(int count, size_t stack_size, int node)
+{
+    for (int i = 0; i < count; i++) {
+        Thread* thread = create(node);
+        if (thread == nullptr) {
+            return false;
+        }
+        bool prepared = thread->prepare(0, nullptr, stack_size);
+        release(thread);
+        if (!prepared) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Thread* ThreadPool::acquire(int thread_id, thread_entry_point entry_point, size_t stack_size, int node)
+{
+    if (node >= MAX_NUMA_NODES) {
+        node = -1;
+    }
+    Thread* thread = free_threads[node + 1].pop_front();
+    if (thread == nullptr) {
+        thread = create(node);
+    }
+    // out of memory for a new thread: one on another node is only slower
+    for (int i = 0; thread == nullptr && i <= MAX_NUMA_NODES; i++) {
+        thread = free_threads[i].pop_front();
+    }
+    if (thread == nullptr) {
+        return nullptr;
+    }
+    if (!thread->prepare(thread_id, entry_point, stack_size)) {
+        release(thread);
+        return nullptr;
+    }
+    return thread;
+}
+
+Thread* ThreadPool::acquire_free(int thread_id, thread_entry_point entry_point, size_t stack_size, int node)
+{
+    if (node >= MAX_NUMA_NODES) {
+        node = -1;
+    }
+    for (int i = 0; i <= MAX_NUMA_NODES; i++) {
+        // the node's own free threads first
+        ThreadQueue& free = free_threads[i == 0 ? node + 1 : i == node + 1 ? 0 : i];
+        for (Thread* thread = free.front(); thread != nullptr; thread = thread->next) {
+            if (thread->stack_fits(stack_size)) {
+                free.remove(thread);
+                thread->prepare(thread_id, entry_point, stack_size);
+                return thread;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::release(Thread* thread)
+{
+    free_threads[thread->node + 1].push_back(thread);
+}
+
+int ThreadPool::size() const
+{
+    int count = 0;
+    for (int i = 0; i <= MAX_NUMA_NODES; i++) {
+        count += free_threads[i].size();
+    }
+    return count;
+}
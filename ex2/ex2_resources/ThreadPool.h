@@ -0,0 +1,49 @@
+//
+// Free list of Thread control blocks together with their stacks.
+//
+
+#ifndef EX2_RESOURCES_THREADPOOL_H
+#define EX2_RESOURCES_THREADPOOL_H
+
+#include "uthreads.h"
+#include "ThreadQueue.h"
+#include "Numa.h"
+#include <stddef.h>
+
+class Thread;
+
+// A terminated thread goes back here with its stack still mapped, and the next spawn takes it out again, so once the
+// pool has grown to the peak number of threads, spawn and terminate neither allocate nor make syscalls.
+// The pool must only get threads that are off their stack - see the reaping in uthreads.cpp.
+// Threads are kept by the NUMA node their memory is on (Thread::node): a spawn for a worker on a known node only
+// recycles a thread of that node, and otherwise has a new control block and stack placed there. The control blocks of
+// a node are carved out of slabs mapped on it, since the heap would place them wherever it has room.
+class ThreadPool {
+public:
+    ThreadPool();
+
+    // Pre-initializes count threads with stacks of stack_size bytes on node (-1 if unknown). Returns false if mmap
+    // fails.
+    bool reserve(int count, size_t stack_size, int node = -1);
+
+    // A thread ready to start at entry_point, recycled when possible, with its memory on node (-1 if unknown). A free
+    // thread of another node is only taken when no new memory can be mapped. Returns nullptr if none could be.
+    Thread* acquire(int thread_id, thread_entry_point entry_point, size_t stack_size, int node = -1);
+    // Like acquire, but only recycles a free thread whose stack fits (see Thread::stack_fits), preferably of node:
+    // neither allocates nor maps memory, so it may be called from a signal handler. Returns nullptr if there is none.
+    Thread* acquire_free(int thread_id, thread_entry_point entry_point, size_t stack_size, int node = -1);
+    void release(Thread* thread);
+
+    int size() const;
+
+private:
+    // A new control block on node, without a stack. Returns nullptr if no slab could be mapped.
+    Thread* create(int node);
+
+    ThreadQueue free_threads[MAX_NUMA_NODES + 1]; // at node + 1, the first for threads of unknown node
+    char* slab[MAX_NUMA_NODES]; // the rest of the current slab of each node
+    int slab_left[MAX_NUMA_NODES]; // control blocks left in it
+};
+
+
+#endif //EX2_RESOURCES_THREADPOOL_H
@@ -0,0 +1,77 @@
+//
+// Intrusive FIFO of threads, used for the READY and BLOCKED lists.
+//
+
+#include "ThreadQueue.h"
+#include "Thread.h"
+
+ThreadQueue::ThreadQueue() : head(nullptr), tail(nullptr), count(0) {}
+
+bool ThreadQueue::empty() const
+{
+    return head == nullptr;
+}
+
+int ThreadQueue::size() const
+{
+    return count;
+}
+
+Thread* ThreadQueue::front() const
+{
+    return head;
+}
+
+Thread* ThreadQueue::back() const
+{
+    return tail;
+}
+
+bool ThreadQueue::contains(const Thread* thread) const
+{
+    return thread != nullptr && thread->queue == this;
+}
+
+void ThreadQueue::push_back(Thread* thread)
+{
+    thread->next = nullptr;
+    thread->prev = tail;
+    thread->queue = this;
+    if (tail != nullptr) {
+        tail->next = thread;
+    } else {
+        head = thread;
+    }
+    tail = thread;
+    count++;
+}
+
+Thread* ThreadQueue::pop_front()
+{
+    Thread* thread = head;
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+void ThreadQueue::remove(Thread* thread)
+{
+    if (!contains(thread)) {
+        return;
+    }
+    if (thread->prev != nullptr) {
+        thread->prev->next = thread->next;
+    } else {
+        head = thread->next;
+    }
+    if (thread->next != nullptr) {
+        thread->next->prev = thread->prev;
+    } else {
+        tail = thread->prev;
+    }
+    thread->next = nullptr;
+    thread->prev = nullptr;
+    thread->queue = nullptr;
+    count--;
+}
@@ -0,0 +1,34 @@
+//
+// Intrusive FIFO of threads, used for the READY and BLOCKED lists.
+//
+
+#ifndef EX2_RESOURCES_THREADQUEUE_H
+#define EX2_RESOURCES_THREADQUEUE_H
+
+class Thread;
+
+// The links live inside Thread (next, prev, queue), so every operation is O(1) and nothing is ever allocated -
+// which matters because the queues are modified from the SIGVTALRM handler.
+// A thread is in at most one queue at a time.
+class ThreadQueue {
+public:
+    ThreadQueue();
+
+    bool empty() const;
+    int size() const;
+    Thread* front() const;
+    Thread* back() const;
+    bool contains(const Thread* thread) const;
+
+    void push_back(Thread* thread);
+    Thread* pop_front(); // returns nullptr if the queue is empty
+    void remove(Thread* thread); // no effect if the thread is not in this queue
+
+private:
+    Thread* head;
+    Thread* tail;
+    int count;
+};
+
+
+#endif //EX2_RESOURCES_THREADQUEUE_H
@@ -0,0 +1,121 @@
+//
+// Hierarchical timing wheel for sleeping threads, keyed on the quantum they wake up at.
+//
+
+#include "TimerWheel.h"
+#include "Thread.h"
+#include <limits.h>
+
+TimerWheel::TimerWheel() : slots(), now(0), count(0) {}
+
+bool TimerWheel::empty() const
+{
+    return count == 0;
+}
+
+int TimerWheel::size() const
+{
+    return count;
+}
+
+bool TimerWheel::contains(const Thread* thread) const
+{
+    return thread != nullptr && thread->sleep_pprev != nullptr;
+}
+
+void TimerWheel::insert(Thread* thread)
+{
+    if (thread->wake_quantum <= now) {
+        // already due: wake it on the next tick
+        thread->wake_quantum = now + 1;
+    }
+    file(thread);
+    count++;
+}
+
+void TimerWheel::remove(Thread* thread)
+{
+    if (!contains(thread)) {
+        return;
+    }
+    *thread->sleep_pprev = thread->sleep_next;
+    if (thread->sleep_next != nullptr) {
+        thread->sleep_next->sleep_pprev = thread->sleep_pprev;
+    }
+    thread->sleep_next = nullptr;
+    thread->sleep_pprev = nullptr;
+    count--;
+}
+
+void TimerWheel::expire(int tick, void (*wake)(Thread*))
+{
+    now = tick;
+
+    // every 64^l ticks the current slot of level l is spread over the levels below it
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        int shift = level * WHEEL_SLOT_BITS;
+        if ((tick & ((1 << shift) - 1)) != 0) {
+            break;
+        }
+        cascade(level, (tick >> shift) & WHEEL_SLOT_MASK);
+    }
+
+    Thread** slot = &slots[0][tick & WHEEL_SLOT_MASK];
+    while (*slot != nullptr) {
+        Thread* thread = *slot;
+        remove(thread);
+        wake(thread);
+    }
+}
+
+int TimerWheel::next_expiry() const
+{
+    if (count == 0) {
+        return INT_MAX;
+    }
+    // the threads of level 0 wake up within 64 ticks, and every 64th tick may cascade others down
+    for (int tick = now + 1;; tick++) {
+        if ((tick & WHEEL_SLOT_MASK) == 0 || slots[0][tick & WHEEL_SLOT_MASK] != nullptr) {
+            return tick;
+        }
+    }
+}
+
+// Puts the thread in the lowest level whose span still covers its wake up time
+void TimerWheel::file(Thread* thread)
+{
+    // delta is 0 only while cascading the slot of the current tick, which expire empties right after
+    long expires = thread->wake_quantum;
+    long delta = expires - now;
+
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1L << ((level + 1) * WHEEL_SLOT_BITS))) {
+        level++;
+    }
+    long span = 1L << ((level + 1) * WHEEL_SLOT_BITS);
+    if (delta >= span) {
+        // beyond the last level: park it in the farthest slot, it is re-filed when that slot cascades
+        expires = now + span - 1;
+    }
+
+    Thread** head = &slots[level][(expires >> (level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK];
+    thread->sleep_next = *head;
+    if (*head != nullptr) {
+        (*head)->sleep_pprev = &thread->sleep_next;
+    }
+    *head = thread;
+    thread->sleep_pprev = head;
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    Thread* thread = slots[level][slot];
+    slots[level][slot] = nullptr;
+    while (thread != nullptr) {
+        Thread* next = thread->sleep_next;
+        thread->sleep_next = nullptr;
+        thread->sleep_pprev = nullptr;
+        file(thread);
+        thread = next;
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Hierarchical timing wheel for sleeping threads, keyed on the quantum they wake up at.
+//
+
+#ifndef EX2_RESOURCES_TIMERWHEEL_H
+#define EX2_RESOURCES_TIMERWHEEL_H
+
+class Thread;
+
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+
+// Level 0 has one slot per quantum, level l has one slot per 64^l quanta, so 4 levels cover 2^24 quanta (longer
+// sleeps are parked in the last level and re-filed when they get there).
+// A thread is filed by its Thread::wake_quantum and linked through Thread::sleep_next/sleep_pprev, so insert and
+// remove are O(1) and a tick only touches the threads that wake up on it, plus the ones cascaded down a level once
+// every 64^l ticks - O(1) amortized per thread no matter how many threads sleep.
+class TimerWheel {
+public:
+    TimerWheel();
+
+    bool empty() const;
+    int size() const;
+    bool contains(const Thread* thread) const;
+
+    // Files the thread under thread->wake_quantum, which must be after the last tick passed to expire
+    void insert(Thread* thread);
+    void remove(Thread* thread); // no effect if the thread is not in the wheel
+
+    // Advances the wheel to tick (called once for every tick, in order) and calls wake for every thread whose
+    // wake_quantum is tick. The thread is already out of the wheel when wake is called.
+    void expire(int tick, void (*wake)(Thread*));
+    // The first tick after the last one passed to expire that may wake a thread, INT_MAX if the wheel is empty. Only
+    // a lower bound: the threads of the upper levels are placed exactly when they cascade down, at every 64th tick.
+    int next_expiry() const;
+
+private:
+    void file(Thread* thread);
+    void cascade(int level, int slot);
+
+    Thread* slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    int now; // last tick passed to expire
+    int count;
+};
+
+
+#endif //EX2_RESOURCES_TIMERWHEEL_H
@@ -0,0 +1,96 @@
+//
+// A kernel thread that runs uthreads, see uthread_options.workers.
+//
+
+#ifndef EX2_RESOURCES_WORKER_H
+#define EX2_RESOURCES_WORKER_H
+
+#include "Thread.h"
+#include "PreemptionTimer.h"
+#include "Stack.h"
+#include "SpinLock.h"
+#include <pthread.h>
+#include <signal.h>
+
+// The scheduler state that belongs to a kernel thread rather than to the whole library: its quantum, its timer and
+// the flags its SIGVTALRM handler shares with the other workers. The classic 1:N mode has a single worker, the kernel
+// thread that called uthread_init_ex. In M:N mode the others are pthreads started by uthread_init_ex, and every worker
+// runs the threads of its own queue (see MultiQueuePolicy).
+// A thread may continue on another worker after any switch, so the scheduler finds its worker anew every time (see
+// me in uthreads.cpp) instead of keeping a pointer to it across a switch. What a thread uses outside the scheduler,
+// where it can be switched at any instruction - the thread the worker runs, and whether it is inside the scheduler -
+// is kept in thread-locals instead, see worker_index in uthreads.cpp.
+struct Worker {
+    int index;
+    pthread_t pthread;
+    int cpu; // the CPU the kernel thread is pinned to (uthread_options.pin_workers), -1 if it isn't
+    int node; // the NUMA node of that CPU, -1 if the kernel thread isn't pinned or the node is unknown
+
+    // In M:N mode, guards the worker's ready queue, its handoff, and the state, affinity and worker of the threads on
+    // that queue or running on the worker, see lock_scheduler in uthreads.cpp. The worker holds it whenever it is
+    // inside the scheduler, across a switch: the thread switched to releases it when it leaves the scheduler.
+    SpinLock queue_lock;
+    // Which locks the worker holds, for whatever thread leaves the scheduler on it to release them
+    bool holds_queue_lock;
+    bool holds_scheduler_lock;
+    // The thread the worker is switching away from, until the context switched to clears its on_cpu, see finish_switch
+    Thread* switched_from;
+    // The worker's running thread, READY again, that goes to another worker's queue at the end of the switch, once
+    // nothing can make this one wait for a lock anymore, see requeue_running_thread
+    Thread* moving;
+
+    // When the running thread was switched to or last charged for its run time, see charge_running_thread
+    long long run_start_ns;
+    // The same moment on the CPU clock of the worker's kernel thread, when threads are charged on it (see cpu_clock_ns)
+    long long cpu_start_ns;
+    // When the running thread was switched to
+    long long quantum_start_ns;
+    // Adaptive quantum of the worker's threads (see adapt_quantum), and a moving average of the time from charging the
+    // thread that leaves the CPU until the next one runs
+    int adaptive_usecs;
+    long long switch_cost_ns;
+
+    // A latency-critical thread that woke up (uthread_attr.latency_critical): it runs next, out of the policy's order,
+    // and preempts the running thread once that ran min_quantum_ns of its quantum, see wakeup_preemption_ns. Also the
+    // thread a uthread_yield_to hands the CPU to, for the handoff_ticks left of the yielding thread's quantum (0 for a
+    // quantum of its own).
+    Thread* handoff;
+    int handoff_ticks;
+
+    // Armed once and left running, see timer_handler. Its period is the quantum of the running thread / quantum_ticks,
+    // see set_quantum_timer.
+    PreemptionTimer timer;
+    int tick_usecs;
+    // Timer ticks left in the running thread's quantum. Starting a quantum only refills the budget, so a switch costs
+    // no timer syscall.
+    volatile sig_atomic_t budget_ticks;
+
+    // Set by another worker that blocked or terminated the running thread, before it signals this one, see kick_worker,
+    // or that gave this one a handoff thread, see hand_off_to. Also set by a post to the inbox in tickless mode, see
+    // notify_inbox.
+    volatile sig_atomic_t kicked;
+
+    // When the policy wants the running thread preempted regardless of its quantum (see
+    // SchedulingPolicy::next_event_ns), checked by timer_handler on every tick. LLONG_MAX while it doesn't.
+    volatile long long policy_event_ns;
+
+    // Where the worker waits for a thread to run in M:N mode, see worker_idle
+    Context idle_context;
+    // Set while the worker runs a thread rather than idles, and so may be kicked: the pthread of a worker other than 0
+    // may not even have reached worker_main yet. Guarded by scheduler_lock.
+    bool busy;
+    // Set while the worker sleeps in park_worker, on wake_word as a futex, which wake_idle_workers sets to 1. A post to
+    // the inbox sets wake_word without the scheduler lock, see notify_inbox.
+    volatile bool parked;
+    volatile int wake_word;
+    // Set once the worker stopped for uthread_terminate(0) on another one, see stop_worker in uthreads.cpp
+    volatile bool stopped;
+    // State of the random choice of the workers to steal threads from, see steal_threads
+    unsigned int steal_seed;
+    Stack idle_stack; // only worker 0 needs one, the pthreads of the others run their idle loop on their own stack
+    // Stack for the SIGSEGV handler, which can't run on a thread stack that just overflowed
+    Stack signal_stack;
+};
+
+
+#endif //EX2_RESOURCES_WORKER_H
@@ -0,0 +1,110 @@
+/*
+ * bench_adaptive_quantum.cpp - fixed against adaptive quantum over a sweep of thread counts.
+ *
+ * THREADS[i] threads (the main thread included) spin for RUN_USECS, each one reading the clock in a loop: a gap
+ * between two reads means the thread was switched out, and how long it waited. For each thread count:
+ *   fixed    - a QUANTUM_USECS quantum
+ *   adaptive - the quantum follows the number of threads, with a target latency of TARGET_LATENCY_USECS, between a
+ *              quarter of QUANTUM_USECS and TARGET_LATENCY_USECS
+ * and reports the switches per second, the overhead (the share of the time that no thread was in its loop: switches,
+ * timer signals and the scheduler) and the mean and max time a thread waited to run again.
+ * Each run is a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUANTUM_USECS 1000
+#define TARGET_LATENCY_USECS 4000
+#define RUN_USECS 1000000
+#define GAP_NS 20000
+
+static volatile bool stop = false;
+static double loop_ns = 0; // time spent between clock reads that were close enough to be in the loop
+static long waits = 0;
+static double wait_sum = 0;
+static double wait_max = 0;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void spin()
+{
+    double last = now_ns();
+    while (!stop) {
+        double now = now_ns();
+        if (now - last > GAP_NS) {
+            waits++;
+            wait_sum += now - last;
+            if (now - last > wait_max) {
+                wait_max = now - last;
+            }
+        } else {
+            loop_ns += now - last;
+        }
+        last = now;
+    }
+    uthread_block(uthread_get_tid());
+}
+
+static void run(int threads, bool adaptive)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = QUANTUM_USECS;
+        options.timer = UTHREAD_TIMER_MONOTONIC;
+        options.max_threads = threads;
+        options.adaptive_quantum = adaptive;
+        options.target_latency_usecs = TARGET_LATENCY_USECS;
+        options.max_quantum_usecs = TARGET_LATENCY_USECS;
+        uthread_init_ex(&options);
+        for (int i = 1; i < threads; i++) {
+            uthread_spawn(spin);
+        }
+
+        double start = now_ns();
+        double end = start + RUN_USECS * 1e3;
+        double last = start;
+        while (last < end) {
+            double now = now_ns();
+            if (now - last > GAP_NS) {
+                waits++;
+                wait_sum += now - last;
+                if (now - last > wait_max) {
+                    wait_max = now - last;
+                }
+            } else {
+                loop_ns += now - last;
+            }
+            last = now;
+        }
+        stop = true;
+        double elapsed = now_ns() - start;
+        printf("%7d %-8s %10.0f %9.1f%% %10.0f %10.0f\n", threads, adaptive ? "adaptive" : "fixed",
+               uthread_get_total_quantums() / (elapsed / 1e9), 100 * (1 - loop_ns / elapsed),
+               waits > 0 ? wait_sum / waits / 1e3 : 0, wait_max / 1e3);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    printf("%7s %-8s %10s %10s %10s %10s\n", "threads", "quantum", "switches/s", "overhead", "mean wait", "max wait");
+    const int counts[] = {2, 8, 32, 96};
+    for (int threads : counts) {
+        run(threads, false);
+        run(threads, true);
+    }
+    printf("waits in micro-seconds\n");
+    return 0;
+}
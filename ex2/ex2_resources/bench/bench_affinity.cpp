@@ -0,0 +1,131 @@
+/*
+ * bench_affinity.cpp - cost of moving threads between workers for a cache-bound load, 2 to N workers pinned to CPUs
+ * of their own (uthread_options.pin_workers).
+ *
+ * Two threads per worker each sweep a working set of their own, WORKING_SET bytes that fit the L2 cache of a core,
+ * PASSES times, giving the CPU up with uthread_yield after every pass, under two placements:
+ *   warm      - the default, a thread is queued on the worker it last ran on
+ *   scattered - placement that ignores cache affinity (uthread_options.scatter_threads): a thread is queued on a
+ *               random worker, so a pass runs on another core than the last one about as often as not
+ * For every worker count prints the wall-clock time until the last thread finished, the migrations of all threads
+ * (uthread_get_migrations) and the slowdown of scattered over warm. N is the number of online CPUs, or the first
+ * argument. Each run is a child process, since the library can only be initialized once.
+ * On fewer cores than workers the workers share cores, so the runs then mostly measure the kernel's time slices.
+ */
+
+#include "uthreads.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THREADS_PER_WORKER 2
+#define WORKING_SET (128 * 1024)
+#define PASSES 500
+#define CACHE_LINE 64
+
+static int threads;
+static std::atomic<int> finished(0);
+static unsigned char* data[2 * UTHREAD_MAX_WORKERS + 1];
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sweep()
+{
+    int tid = uthread_get_tid();
+    unsigned char* set = data[tid];
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int i = 0; i < WORKING_SET; i += CACHE_LINE) {
+            set[i]++;
+        }
+        uthread_yield();
+    }
+    finished++;
+    // blocked rather than terminated, so that its migrations can still be read
+    uthread_block(tid);
+}
+
+struct Result {
+    double ms;
+    long migrations;
+};
+
+// Returns ms < 0 if the run failed
+static Result run(int worker_count, bool scatter)
+{
+    Result result = {-1, 0};
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return result;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        threads = worker_count * THREADS_PER_WORKER;
+        for (int tid = 1; tid <= threads; tid++) {
+            data[tid] = (unsigned char*) calloc(WORKING_SET, 1);
+        }
+        uthread_options options = {};
+        options.quantum_usecs = 10000;
+        options.workers = worker_count;
+        options.pin_workers = 1;
+        options.scatter_threads = scatter;
+        if (uthread_init_ex(&options) == 0) {
+            double start = now_ns();
+            for (int i = 0; i < threads; i++) {
+                uthread_spawn(sweep);
+            }
+            while (finished < threads) {
+                uthread_yield();
+            }
+            result.ms = (now_ns() - start) / 1e6;
+            for (int tid = 1; tid <= threads; tid++) {
+                result.migrations += uthread_get_migrations(tid);
+            }
+        }
+        if (write(fds[1], &result, sizeof(result)) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    if (read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+        result.ms = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int max_workers = argc > 1 ? atoi(argv[1]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_workers < 2) {
+        max_workers = 2;
+    }
+    if (max_workers > UTHREAD_MAX_WORKERS) {
+        max_workers = UTHREAD_MAX_WORKERS;
+    }
+    printf("%d threads per worker, %d KB each, %d passes\n", THREADS_PER_WORKER, WORKING_SET / 1024, PASSES);
+    printf("%-8s %10s %12s %12s %12s %9s\n", "workers", "warm ms", "migrations", "scattered ms", "migrations",
+           "slowdown");
+    for (int worker_count = 2; worker_count <= max_workers; worker_count++) {
+        Result warm = run(worker_count, false);
+        Result scatter = run(worker_count, true);
+        if (warm.ms < 0 || scatter.ms < 0) {
+            printf("%-8d %10s\n", worker_count, "failed");
+            continue;
+        }
+        printf("%-8d %10.1f %12ld %12.1f %12ld %9.2f\n", worker_count, warm.ms, warm.migrations, scatter.ms,
+               scatter.migrations, scatter.ms / warm.ms);
+    }
+    return 0;
+}
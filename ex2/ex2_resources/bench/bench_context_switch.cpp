@@ -0,0 +1,99 @@
+/*
+ * bench_context_switch.cpp - cost of a single thread switch.
+ *
+ * Ping-pongs between the main stack and a second stack, first with sigsetjmp(env, 1)/siglongjmp (what
+ * jump_to_next_thread used to do, one rt_sigprocmask per jump) and then with context_switch from Thread.h.
+ * Prints the average cost of one switch for each.
+ */
+
+#include "Thread.h"
+#include <stdio.h>
+#include <setjmp.h>
+#include <time.h>
+
+#define ROUNDS 1000000
+#define PEER_STACK_SIZE 65536
+
+// Code from demo_jmp.c
+typedef unsigned long address_t;
+#define JB_SP 6
+#define JB_PC 7
+
+address_t translate_address(address_t addr)
+{
+    address_t ret;
+    asm volatile("xor    %%fs:0x30,%0\n"
+                 "rol    $0x11,%0\n"
+            : "=g" (ret)
+            : "0" (addr));
+    return ret;
+}
+
+static char peer_stack[PEER_STACK_SIZE];
+
+static sigjmp_buf main_env;
+static sigjmp_buf peer_env;
+
+static Context main_context;
+static Context peer_context;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sigjmp_peer()
+{
+    for (;;) {
+        if (sigsetjmp(peer_env, 1) == 0) {
+            siglongjmp(main_env, 1);
+        }
+    }
+}
+
+static double bench_sigjmp()
+{
+    address_t sp = (address_t) peer_stack + PEER_STACK_SIZE - sizeof(address_t);
+    sigsetjmp(peer_env, 1);
+    (peer_env->__jmpbuf)[JB_SP] = translate_address(sp);
+    (peer_env->__jmpbuf)[JB_PC] = translate_address((address_t) sigjmp_peer);
+
+    double start = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        if (sigsetjmp(main_env, 1) == 0) {
+            siglongjmp(peer_env, 1);
+        }
+    }
+    return (now_ns() - start) / (2.0 * ROUNDS);
+}
+
+static void context_peer()
+{
+    for (;;) {
+        context_switch(&peer_context, &main_context);
+    }
+}
+
+static double bench_context_switch()
+{
+    // the frame Thread::prepare builds, with context_peer as the return address instead of thread_bootstrap
+    prepare_context(&peer_context, peer_stack + PEER_STACK_SIZE, context_peer);
+
+    double start = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        context_switch(&main_context, &peer_context);
+    }
+    return (now_ns() - start) / (2.0 * ROUNDS);
+}
+
+int main()
+{
+    double before = bench_sigjmp();
+    double after = bench_context_switch();
+    printf("sigsetjmp/siglongjmp: %8.1f ns per switch\n", before);
+    printf("context_switch:       %8.1f ns per switch\n", after);
+    printf("speedup:              %8.1fx\n", before / after);
+    return 0;
+}
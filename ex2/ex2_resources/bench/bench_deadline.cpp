@@ -0,0 +1,135 @@
+/*
+ * bench_deadline.cpp - deadline-miss ratio versus load.
+ *
+ * PERIODIC threads run a job every PERIOD_USECS, due at the end of the period, next to HOGS threads (and the main
+ * thread) that spin all along. The load is the CPU time the periodic jobs need, as a fraction of the CPU; a job is a
+ * calibrated busy loop, so it needs the same CPU time whoever runs around it. For each load:
+ *   rr  - the periodic threads are plain round-robin threads that spin until their next release
+ *   edf - they are deadline threads admitted for 95% of the CPU in total, ending each job with uthread_wait_period
+ * A job is missed if it is done after the end of the period it started in. Under EDF a load above 95% is beyond
+ * what was admitted, and the jobs that overrun their runtime are throttled instead of taking the hogs' CPU.
+ * Each run is a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PERIODIC 4
+#define HOGS 2
+#define PERIOD_USECS 2000
+#define PERIODS 200
+#define QUANTUM_USECS 1000
+#define TIMER_TICKS 10
+
+static double iterations_per_usec = 0;
+static long job_iterations = 0;
+static bool deadline_threads = false;
+static double start_usecs = 0;
+static volatile long jobs = 0;
+static volatile long misses = 0;
+static volatile int finished = 0;
+
+static double now_usecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void calibrate()
+{
+    long iterations = 50000000;
+    double start = now_usecs();
+    for (volatile long i = 0; i < iterations; i++) {
+    }
+    iterations_per_usec = iterations / (now_usecs() - start);
+}
+
+static void hog()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+// A job is released at the start of the period it starts in: a thread that is late skips the periods it missed
+static void periodic()
+{
+    for (int k = 0; k < PERIODS; k++) {
+        double release = start_usecs + (long) ((now_usecs() - start_usecs) / PERIOD_USECS) * PERIOD_USECS;
+        for (volatile long i = 0; i < job_iterations; i++) {
+        }
+        jobs++;
+        if (now_usecs() > release + PERIOD_USECS) {
+            misses++;
+        }
+        if (deadline_threads) {
+            uthread_wait_period();
+        } else {
+            double next = start_usecs + (long) ((now_usecs() - start_usecs) / PERIOD_USECS + 1) * PERIOD_USECS;
+            while (now_usecs() < next) {
+            }
+        }
+    }
+    finished++;
+    uthread_block(uthread_get_tid());
+}
+
+static void run(double load, bool edf)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = QUANTUM_USECS;
+        options.timer = UTHREAD_TIMER_MONOTONIC;
+        options.timer_ticks = TIMER_TICKS;
+        uthread_init_ex(&options);
+
+        deadline_threads = edf;
+        job_iterations = (long) (load * PERIOD_USECS / PERIODIC * iterations_per_usec);
+        for (int i = 0; i < HOGS; i++) {
+            uthread_spawn(hog);
+        }
+        uthread_deadline params = {};
+        params.runtime_usecs = PERIOD_USECS * 95 / 100 / PERIODIC;
+        params.period_usecs = PERIOD_USECS;
+        // a deadline thread preempts the main thread right away, so all of them are set up blocked to get their
+        // periods in phase
+        int tids[PERIODIC];
+        for (int i = 0; i < PERIODIC; i++) {
+            tids[i] = uthread_spawn(periodic);
+            uthread_block(tids[i]);
+        }
+        start_usecs = now_usecs();
+        for (int i = 0; i < PERIODIC; i++) {
+            if (edf) {
+                uthread_set_deadline(tids[i], &params);
+            }
+        }
+        for (int i = 0; i < PERIODIC; i++) {
+            uthread_resume(tids[i]);
+        }
+        while (finished < PERIODIC) {
+        }
+        printf("%-4s %5.2f %8ld %8ld %10.3f\n", edf ? "edf" : "rr", load, jobs, misses, (double) misses / jobs);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    calibrate();
+    printf("%-4s %5s %8s %8s %10s\n", "mode", "load", "jobs", "misses", "miss ratio");
+    const double loads[] = {0.2, 0.4, 0.6, 0.8, 0.9, 1.0, 1.2};
+    for (double load : loads) {
+        run(load, false);
+        run(load, true);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * bench_fp_switch.cpp - switch cost of integer-only threads against threads with a floating-point environment.
+ *
+ * First the bare switch: context_switch against context_switch_fp, which also keeps MXCSR and the x87 control word.
+ * Then two threads pass the CPU back and forth with uthread_yield_to SWITCHES times, each one doing a little work in
+ * between:
+ *   integer      - plain threads summing integers
+ *   simd fp_env  - threads with uthread_attr.fp_env, one rounding upward and one downward, running a vectorizable
+ *                  loop over doubles and checking their rounding after every switch
+ *   simd plain   - the same threads without fp_env, whose rounding modes leak into each other
+ * and prints the time per switch (work included) and the switches after which a thread found the wrong rounding.
+ * Each library run is a child process, since the library can only be initialized once.
+ */
+
+#include "Thread.h"
+#include <fenv.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROUNDS 1000000
+#define PEER_STACK_SIZE 65536
+#define SWITCHES 200000
+#define VECTOR 64
+
+typedef unsigned long address_t;
+
+static char peer_stack[PEER_STACK_SIZE];
+static Context main_context;
+static Context peer_context;
+
+static int tids[2];
+static volatile int finished = 0;
+static long errors = 0;
+static volatile long integer_sink = 0;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void peer()
+{
+    for (;;) {
+        context_switch(&peer_context, &main_context);
+    }
+}
+
+static void peer_fp()
+{
+    for (;;) {
+        context_switch_fp(&peer_context, &main_context);
+    }
+}
+
+static double bench_bare(thread_entry_point entry_point, bool fp)
+{
+    // same frame Thread::prepare builds, with the peer as the return address instead of thread_bootstrap
+    address_t* sp = (address_t*) (((address_t) peer_stack + PEER_STACK_SIZE) & ~(address_t) 15);
+    *--sp = 0;
+    *--sp = (address_t) entry_point;
+    for (int i = 0; i < 6; i++) {
+        *--sp = 0;
+    }
+    peer_context.sp = sp;
+    save_fp_control(&peer_context);
+
+    double start = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        if (fp) {
+            context_switch_fp(&main_context, &peer_context);
+        } else {
+            context_switch(&main_context, &peer_context);
+        }
+    }
+    return (now_ns() - start) / (2.0 * ROUNDS);
+}
+
+static int other()
+{
+    return uthread_get_tid() == tids[0] ? tids[1] : tids[0];
+}
+
+static void integer_worker()
+{
+    long sum = 0;
+    for (int i = 0; i < SWITCHES / 2; i++) {
+        for (int j = 0; j < VECTOR; j++) {
+            sum += j ^ i;
+        }
+        uthread_yield_to(other());
+    }
+    integer_sink = sum;
+    finished++;
+    uthread_block(uthread_get_tid());
+}
+
+static void simd_worker()
+{
+    int rounding = uthread_get_tid() == tids[0] ? FE_UPWARD : FE_DOWNWARD;
+    fesetround(rounding);
+    volatile double one = 1;
+    volatile double minus_one = -1; // so that the compiler can't make -1/3 out of 1/3
+    volatile double three = 3;
+    double values[VECTOR];
+    for (int j = 0; j < VECTOR; j++) {
+        values[j] = j;
+    }
+    for (int i = 0; i < SWITCHES / 2; i++) {
+        double third = one / three;
+        for (int j = 0; j < VECTOR; j++) {
+            values[j] = values[j] * third + third;
+        }
+        // 1/3 rounds to a bigger magnitude than -1/3 upward, to a smaller one downward
+        double minus_third = minus_one / three;
+        if (fegetround() != rounding || (rounding == FE_UPWARD) != (third > -minus_third)) {
+            errors++;
+        }
+        uthread_yield_to(other());
+    }
+    integer_sink = (long) values[VECTOR - 1];
+    finished++;
+    uthread_block(uthread_get_tid());
+}
+
+static void run(const char* name, thread_entry_point worker, bool fp_env)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_init(100000000);
+        uthread_attr attrs = {};
+        attrs.fp_env = fp_env;
+        tids[0] = uthread_spawn_ex(worker, &attrs);
+        tids[1] = uthread_spawn_ex(worker, &attrs);
+        double start = now_ns();
+        while (finished < 2) {
+            uthread_yield();
+        }
+        double elapsed = now_ns() - start;
+        printf("%-14s %10.1f ns per switch %8ld wrong rounding\n", name, elapsed / SWITCHES, errors);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    double plain = bench_bare(peer, false);
+    double fp = bench_bare(peer_fp, true);
+    printf("context_switch:    %8.1f ns per switch\n", plain);
+    printf("context_switch_fp: %8.1f ns per switch\n", fp);
+    run("integer", integer_worker, false);
+    run("simd fp_env", simd_worker, true);
+    run("simd plain", simd_worker, false);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * bench_inbox.cpp - latency of uthread_post_resume from a pthread outside the library.
+ *
+ * A server thread blocks itself over and over, and a listener pthread resumes it through the inbox ROUNDS times,
+ * while the main thread keeps the CPU busy without library calls. Prints the median and worst time from the post
+ * until the server runs:
+ *   1 worker           - the request is carried out at the next tick, the server runs at the end of the quantum
+ *   1 worker, tickless - the main thread runs alone with the timer stopped, so the post kicks the worker to have the
+ *                        request carried out and the timer started, the server still waits for the end of the quantum
+ *   2 workers          - the second worker is parked, the post wakes it up to run the server
+ * Each run is a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <algorithm>
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROUNDS 200
+#define QUANTUM_USECS 10000
+// A post that lands before the server blocked is lost, the listener posts again after this long
+#define RETRY_NS 100000000LL
+#define POLL_NS 50000
+
+static std::atomic<int> served(0);
+static std::atomic<bool> blocking(false);
+static std::atomic<bool> done(false);
+static std::atomic<long long> served_ns(0);
+static int server_tid;
+
+static long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void server()
+{
+    for (;;) {
+        blocking = true;
+        uthread_block(server_tid);
+        served_ns = now_ns();
+        served++;
+    }
+}
+
+// The listener polls with short sleeps rather than spinning, so that it doesn't keep a core the workers may need
+static void pause_ns(long ns)
+{
+    struct timespec pause = {0, ns};
+    nanosleep(&pause, nullptr);
+}
+
+static void* listener(void* arg)
+{
+    long long* latencies = (long long*) arg;
+    for (int i = 0; i < ROUNDS; i++) {
+        while (!blocking) {
+            pause_ns(POLL_NS);
+        }
+        blocking = false;
+        // gives the server time to block after it set the flag
+        pause_ns(1000000);
+        long long posted = now_ns();
+        uthread_post_resume(server_tid);
+        while (served <= i) {
+            pause_ns(POLL_NS);
+            if (now_ns() - posted > RETRY_NS) {
+                posted = now_ns();
+                uthread_post_resume(server_tid);
+            }
+        }
+        latencies[i] = served_ns - posted;
+    }
+    done = true;
+    return nullptr;
+}
+
+// Fills the median and the worst latency in us, returns false if the run failed
+static bool run(int workers, bool tickless, double* median, double* worst)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        double result[2] = {-1, -1};
+        uthread_options options = {};
+        options.quantum_usecs = QUANTUM_USECS;
+        options.workers = workers;
+        options.tickless = tickless;
+        if (uthread_init_ex(&options) == 0) {
+            server_tid = uthread_spawn(server);
+            static long long latencies[ROUNDS];
+            // the listener must not take the timer signal of the library
+            sigset_t timer_signal, old_mask;
+            sigemptyset(&timer_signal);
+            sigaddset(&timer_signal, SIGVTALRM);
+            pthread_sigmask(SIG_BLOCK, &timer_signal, &old_mask);
+            pthread_t thread;
+            pthread_create(&thread, nullptr, &listener, latencies);
+            pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+            while (!done) {
+            }
+            pthread_join(thread, nullptr);
+            std::sort(latencies, latencies + ROUNDS);
+            result[0] = latencies[ROUNDS / 2] / 1e3;
+            result[1] = latencies[ROUNDS - 1] / 1e3;
+        }
+        if (write(fds[1], result, sizeof(result)) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    double result[2] = {-1, -1};
+    if (read(fds[0], result, sizeof(result)) != sizeof(result)) {
+        result[0] = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    *median = result[0];
+    *worst = result[1];
+    return result[0] >= 0;
+}
+
+int main()
+{
+    struct {
+        const char* name;
+        int workers;
+        bool tickless;
+    } modes[] = {
+        {"1 worker", 1, false},
+        {"1 worker, tickless", 1, true},
+        {"2 workers", 2, false},
+    };
+    printf("%d posts, quantum %d us\n", ROUNDS, QUANTUM_USECS);
+    printf("%-20s %12s %12s\n", "mode", "median us", "worst us");
+    for (auto& mode : modes) {
+        double median, worst;
+        if (!run(mode.workers, mode.tickless, &median, &worst)) {
+            printf("%-20s %12s\n", mode.name, "failed");
+            continue;
+        }
+        printf("%-20s %12.1f %12.1f\n", mode.name, median, worst);
+    }
+    return 0;
+}
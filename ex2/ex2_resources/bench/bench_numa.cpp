@@ -0,0 +1,219 @@
+/*
+ * bench_numa.cpp - cost of running a thread on another NUMA node than the one its stack was placed on, with pinned
+ * workers (uthread_options.pin_workers), which place the stack of a thread on the node of the worker that spawned it.
+ *
+ * A thread chases pointers through a random cycle in a WORKING_SET byte array on its own stack, far bigger than the
+ * caches, so that every step is a memory access, and prints the time per step. It always runs on the same worker R,
+ * the first worker whose CPU is on another node than the one of worker 0:
+ *   local  - spawned by a thread on worker R, its stack is on R's node
+ *   remote - spawned by the main thread on worker 0, then bound to R (uthread_set_affinity), as if R had stolen it -
+ *            the stack stays on the node of worker 0 even though the thread touches it first from R
+ * Also prints the node the stack prefers (get_mempolicy) and the node of the CPU that ran the thread. Each run is a
+ * child process, since the library can only be initialized once.
+ * With a single node there is no worker R, worker 1 takes its place and both rows measure the same memory. numactl
+ * can't make up a second node either: the library binds every stack to a node of its own (mbind), which takes
+ * precedence over a policy numactl --membind or --preferred sets for the process. On a host with several nodes it can
+ * still restrict the CPUs, and so the workers, to the nodes to compare, e.g. numactl --cpunodebind=0,1.
+ */
+
+#include "uthreads.h"
+#include <atomic>
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WORKING_SET (64 * 1024 * 1024)
+#define ELEMENTS (WORKING_SET / sizeof(size_t))
+#define STEPS (8 * 1024 * 1024)
+#define MAX_NODES 64
+
+static int remote_worker;
+static int worker_node[UTHREAD_MAX_WORKERS];
+static std::atomic<int> probed(0);
+static std::atomic<bool> done(false);
+static volatile size_t sink; // keeps the chase from being optimized away
+
+struct Result {
+    double ns_per_step;
+    int memory_node;
+    int cpu_node;
+};
+static Result result;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int current_node()
+{
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) < 0) {
+        return -1;
+    }
+    return (int) node;
+}
+
+static int preferred_node(void* addr)
+{
+    int mode;
+    unsigned long mask = 0;
+    if (syscall(SYS_get_mempolicy, &mode, &mask, (unsigned long) MAX_NODES + 1, addr, MPOL_F_ADDR) < 0 ||
+        mode != MPOL_PREFERRED || mask == 0) {
+        return -1;
+    }
+    return __builtin_ctzl(mask);
+}
+
+// Records the node of the CPU of the worker its tid - 1 names
+static void probe()
+{
+    int tid = uthread_get_tid();
+    uthread_set_affinity(tid, 1ULL << (tid - 1));
+    worker_node[tid - 1] = current_node();
+    probed++;
+    uthread_terminate(tid);
+}
+
+static void chase()
+{
+    int tid = uthread_get_tid();
+    uthread_set_affinity(tid, 1ULL << remote_worker);
+    size_t next[ELEMENTS];
+    // Sattolo's shuffle, a single cycle through all elements
+    for (size_t i = 0; i < ELEMENTS; i++) {
+        next[i] = i;
+    }
+    unsigned int seed = 1;
+    for (size_t i = ELEMENTS - 1; i > 0; i--) {
+        size_t j = rand_r(&seed) % i;
+        size_t swap = next[i];
+        next[i] = next[j];
+        next[j] = swap;
+    }
+    size_t position = 0;
+    double start = now_ns();
+    for (int step = 0; step < STEPS; step++) {
+        position = next[position];
+    }
+    result.ns_per_step = (now_ns() - start) / STEPS;
+    sink = position;
+    result.memory_node = preferred_node(next);
+    result.cpu_node = current_node();
+    done = true;
+    uthread_terminate(tid);
+}
+
+static void spawn_chase()
+{
+    uthread_attr attr = {};
+    attr.stack_size = WORKING_SET + 1024 * 1024;
+    uthread_spawn_ex(chase, &attr);
+}
+
+static void local_spawner()
+{
+    int tid = uthread_get_tid();
+    uthread_set_affinity(tid, 1ULL << remote_worker);
+    spawn_chase();
+    uthread_terminate(tid);
+}
+
+// Returns ns_per_step < 0 if the run failed. Prints the worker R chose on the first run.
+static Result run(int workers, bool remote, bool first)
+{
+    Result failed = {-1, -1, -1};
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return failed;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        result = failed;
+        uthread_options options = {};
+        options.quantum_usecs = 10000;
+        options.workers = workers;
+        options.pin_workers = 1;
+        if (uthread_init_ex(&options) == 0) {
+            uthread_set_affinity(0, 1ULL << 0);
+            worker_node[0] = current_node();
+            for (int i = 1; i < workers; i++) {
+                uthread_spawn(probe);
+            }
+            while (probed < workers - 1) {
+                uthread_yield();
+            }
+            remote_worker = 1;
+            for (int i = 1; i < workers; i++) {
+                if (worker_node[i] != worker_node[0]) {
+                    remote_worker = i;
+                    break;
+                }
+            }
+            if (first) {
+                printf("worker R is worker %d, on node %d, worker 0 is on node %d%s\n", remote_worker,
+                       worker_node[remote_worker], worker_node[0],
+                       worker_node[remote_worker] == worker_node[0] ? " - a single node" : "");
+                fflush(stdout);
+            }
+            if (remote) {
+                spawn_chase();
+            } else {
+                uthread_spawn(local_spawner);
+            }
+            // sleeps in the kernel rather than yields, so that worker 0 leaves its core alone, in case R shares it
+            while (!done) {
+                usleep(1000);
+            }
+        }
+        if (write(fds[1], &result, sizeof(result)) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    Result child;
+    if (read(fds[0], &child, sizeof(child)) != sizeof(child)) {
+        child = failed;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    return child;
+}
+
+int main()
+{
+    int workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < 2) {
+        workers = 2;
+    }
+    if (workers > UTHREAD_MAX_WORKERS) {
+        workers = UTHREAD_MAX_WORKERS;
+    }
+    printf("%d workers, %d MB working set, %d steps\n", workers, WORKING_SET / (1024 * 1024), STEPS);
+    Result local = run(workers, false, true);
+    Result remote = run(workers, true, false);
+    printf("%-8s %12s %12s %12s\n", "mode", "memory node", "CPU node", "ns / step");
+    const char* names[] = {"local", "remote"};
+    Result* results[] = {&local, &remote};
+    for (int i = 0; i < 2; i++) {
+        if (results[i]->ns_per_step < 0) {
+            printf("%-8s %12s\n", names[i], "failed");
+            continue;
+        }
+        printf("%-8s %12d %12d %12.1f\n", names[i], results[i]->memory_node, results[i]->cpu_node,
+               results[i]->ns_per_step);
+    }
+    if (local.ns_per_step > 0 && remote.ns_per_step > 0) {
+        printf("remote / local %.2f\n", remote.ns_per_step / local.ns_per_step);
+    }
+    return 0;
+}
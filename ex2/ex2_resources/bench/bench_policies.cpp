@@ -0,0 +1,102 @@
+/*
+ * bench_policies.cpp - scheduling policies side by side on a mixed load.
+ *
+ * HOGS threads (and the main thread) burn every tick they get, INTERACTIVE threads sleep for one quantum, do one tick
+ * of work and sleep again, ROUNDS times. Ticks are raised by the running thread itself, so the load is the same for every policy and the results are
+ * counted in quantums, independent of the machine. For each policy:
+ *   wait      - quantums an interactive thread waited between the end of its sleep and running, mean and max
+ *   quantums  - quantums until the interactive threads were done
+ *   hog ticks - ticks of work the hogs got done meanwhile
+ *   ns/tick   - wall-clock cost of a tick, scheduler included
+ * fair charges the measured run time rather than quantums, so it is the one policy whose choices depend on the machine.
+ * Each policy runs in a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <stdio.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HOGS 8
+#define INTERACTIVE 4
+#define ROUNDS 2000
+
+static long hog_ticks = 0;
+static long waits = 0;
+static long wait_sum = 0;
+static int wait_max = 0;
+static int finished = 0;
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void hog()
+{
+    for (;;) {
+        hog_ticks++;
+        raise(SIGVTALRM);
+    }
+}
+
+static void interactive()
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        int slept = uthread_get_total_quantums();
+        uthread_sleep(1);
+        // the sleep ends with quantum slept + 1, so slept + 2 is the first quantum it could run in
+        int wait = uthread_get_total_quantums() - (slept + 2);
+        wait_sum += wait;
+        waits++;
+        if (wait > wait_max) {
+            wait_max = wait;
+        }
+        raise(SIGVTALRM);
+    }
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+static void run(const char* name, int policy)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = 999999;
+        options.timer_ticks = 1; // every raise() ends a quantum
+        options.policy = policy;
+        uthread_init_ex(&options);
+        for (int i = 0; i < HOGS; i++) {
+            uthread_spawn(hog);
+        }
+        for (int i = 0; i < INTERACTIVE; i++) {
+            uthread_spawn(interactive);
+        }
+
+        double start = now_ns();
+        while (finished < INTERACTIVE) {
+            hog_ticks++;
+            raise(SIGVTALRM);
+        }
+        double elapsed = now_ns() - start;
+        printf("%-6s %10.2f %8d %10d %10ld %8.1f\n", name, (double) wait_sum / waits, wait_max,
+               uthread_get_total_quantums(), hog_ticks, elapsed / (hog_ticks + waits));
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    printf("%-6s %10s %8s %10s %10s %8s\n", "policy", "mean wait", "max wait", "quantums", "hog ticks", "ns/tick");
+    run("rr", UTHREAD_POLICY_RR);
+    run("mlfq", UTHREAD_POLICY_MLFQ);
+    run("fair", UTHREAD_POLICY_FAIR);
+    return 0;
+}
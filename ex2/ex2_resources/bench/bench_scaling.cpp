@@ -0,0 +1,109 @@
+/*
+ * bench_scaling.cpp - throughput of CPU-bound threads on 1 to N workers (uthread_options.workers).
+ *
+ * THREADS threads compute WORK steps of a xorshift chain each, while the main thread yields until they are done. For
+ * every worker count prints the wall-clock time until the last thread finished and the speedup over one worker, which
+ * is bounded by the cores the process gets. N is the number of online CPUs, or the first argument.
+ * Each run is a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THREADS 32
+#define WORK 40000000L
+
+static std::atomic<int> finished(0);
+static volatile unsigned long sink[THREADS + 1];
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void compute()
+{
+    int tid = uthread_get_tid();
+    unsigned long x = tid;
+    for (long i = 0; i < WORK; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    sink[tid] = x;
+    finished++;
+    uthread_terminate(tid);
+}
+
+// Returns the elapsed time in ms, or a negative value if the run failed
+static double run(int workers)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        uthread_options options = {};
+        options.quantum_usecs = 10000;
+        options.workers = workers;
+        double elapsed = -1;
+        if (uthread_init_ex(&options) == 0) {
+            double start = now_ns();
+            for (int i = 0; i < THREADS; i++) {
+                uthread_spawn(compute);
+            }
+            while (finished < THREADS) {
+                uthread_yield();
+            }
+            elapsed = (now_ns() - start) / 1e6;
+        }
+        if (write(fds[1], &elapsed, sizeof(elapsed)) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    double elapsed = -1;
+    if (read(fds[0], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) {
+        elapsed = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+    int max_workers = argc > 1 ? atoi(argv[1]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_workers < 1) {
+        max_workers = 1;
+    }
+    if (max_workers > UTHREAD_MAX_WORKERS) {
+        max_workers = UTHREAD_MAX_WORKERS;
+    }
+    printf("%d threads, %ld steps each\n", THREADS, WORK);
+    printf("%-8s %10s %8s\n", "workers", "ms", "speedup");
+    double base = 0;
+    for (int workers = 1; workers <= max_workers; workers++) {
+        double elapsed = run(workers);
+        if (elapsed < 0) {
+            printf("%-8d %10s\n", workers, "failed");
+            continue;
+        }
+        if (workers == 1) {
+            base = elapsed;
+        }
+        printf("%-8d %10.1f %8.2f\n", workers, elapsed, base / elapsed);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * bench_sleep_wheel.cpp - per-quantum cost of waking sleeping threads, as a function of the number of sleepers.
+ *
+ * "table scan" is what decrease_sleeping used to do: walk every thread and count its remaining sleep down.
+ * "timer wheel" is TimerWheel::expire. Every thread that wakes goes right back to sleep for a random number of
+ * quantums, so the number of sleepers stays constant during a run and about sleepers / 500 threads wake up on each
+ * quantum. The wheel's cost per quantum follows the number of threads woken, not the number sleeping.
+ */
+
+#include "Thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#define TICKS 5000
+#define MAX_SLEEP 1000
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long woken = 0;
+
+static double bench_table_scan(std::vector<Thread*>& sleepers)
+{
+    for (Thread* t : sleepers) {
+        t->wake_quantum = 1 + rand() % MAX_SLEEP; // used as the remaining count here
+    }
+    double start = now_ns();
+    for (int tick = 1; tick <= TICKS; tick++) {
+        for (Thread* t : sleepers) {
+            if (t->wake_quantum > 0) {
+                t->wake_quantum--;
+                if (t->wake_quantum == 0) {
+                    woken++;
+                    t->wake_quantum = 1 + rand() % MAX_SLEEP;
+                }
+            }
+        }
+    }
+    return (now_ns() - start) / TICKS;
+}
+
+static TimerWheel* wheel;
+static int current_tick;
+
+static void wake(Thread* t)
+{
+    woken++;
+    t->wake_quantum = current_tick + 1 + rand() % MAX_SLEEP;
+    wheel->insert(t);
+}
+
+static double bench_timer_wheel(std::vector<Thread*>& sleepers, double* per_wake)
+{
+    TimerWheel w;
+    wheel = &w;
+    for (Thread* t : sleepers) {
+        t->wake_quantum = 1 + rand() % MAX_SLEEP;
+        w.insert(t);
+    }
+    long woken_before = woken;
+    double start = now_ns();
+    for (current_tick = 1; current_tick <= TICKS; current_tick++) {
+        w.expire(current_tick, &wake);
+    }
+    double elapsed = now_ns() - start;
+    for (Thread* t : sleepers) {
+        w.remove(t);
+    }
+    *per_wake = elapsed / (woken - woken_before);
+    return elapsed / TICKS;
+}
+
+int main()
+{
+    int counts[] = {10, 100, 1000, 10000, 50000};
+    printf("%10s %18s %18s %18s\n", "sleepers", "table scan ns/q", "timer wheel ns/q", "wheel ns/wakeup");
+    for (int n : counts) {
+        std::vector<Thread*> sleepers;
+        for (int i = 0; i < n; i++) {
+            sleepers.push_back(new Thread());
+        }
+        srand(1);
+        double scan = bench_table_scan(sleepers);
+        srand(1);
+        double per_wake;
+        double wheel_cost = bench_timer_wheel(sleepers, &per_wake);
+        printf("%10d %18.1f %18.1f %18.1f\n", n, scan, wheel_cost, per_wake);
+        for (Thread* t : sleepers) {
+            delete t;
+        }
+    }
+    return woken == 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * bench_spawn_terminate.cpp - spawn/terminate churn.
+ *
+ * "unpooled" is what spawn and terminate used to cost: a new Thread with a freshly mapped stack, then munmap and
+ * delete. The two library runs go through uthread_spawn/uthread_terminate with the thread pool:
+ *   spawn + terminate - the main thread spawns a thread and terminates it before it ever runs
+ *   full lifecycle    - the spawned thread runs and terminates itself, so it is reaped after the switch back
+ * operator new is counted during the library runs; once the pool is warm it should stay at 0.
+ */
+
+#include "Thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <new>
+
+#define CYCLES 200000
+
+static bool counting = false;
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (counting) {
+        allocations++;
+    }
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void nop()
+{
+}
+
+static void report(const char* name, double elapsed)
+{
+    printf("%-18s %10.0f cycles/s %8.1f ns/cycle %8ld allocations\n", name, CYCLES / (elapsed / 1e9),
+           elapsed / CYCLES, allocations);
+}
+
+int main()
+{
+    double start = now_ns();
+    for (int i = 0; i < CYCLES; i++) {
+        Thread* thread = new Thread();
+        thread->prepare(1, nop, STACK_SIZE);
+        delete thread;
+    }
+    double elapsed = now_ns() - start;
+    printf("%-18s %10.0f cycles/s %8.1f ns/cycle\n", "unpooled", CYCLES / (elapsed / 1e9), elapsed / CYCLES);
+
+    uthread_options options = {};
+    options.quantum_usecs = 999999;
+    options.timer_ticks = 1; // every raise() ends a quantum
+    options.pool_threads = 1;
+    uthread_init_ex(&options);
+
+    allocations = 0;
+    counting = true;
+    start = now_ns();
+    for (int i = 0; i < CYCLES; i++) {
+        uthread_terminate(uthread_spawn(nop));
+    }
+    counting = false;
+    report("spawn + terminate", now_ns() - start);
+
+    allocations = 0;
+    counting = true;
+    start = now_ns();
+    for (int i = 0; i < CYCLES; i++) {
+        uthread_spawn(nop);
+        raise(SIGVTALRM); // let it run; it returns from nop and terminates itself
+    }
+    counting = false;
+    report("full lifecycle", now_ns() - start);
+
+    uthread_terminate(0);
+    return 0;
+}
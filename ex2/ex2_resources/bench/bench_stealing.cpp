@@ -0,0 +1,140 @@
+/*
+ * bench_stealing.cpp - throughput under imbalanced spawn patterns, 1 to N workers (uthread_options.workers).
+ *
+ * A new thread is queued on the worker of its spawner, so all of these start out on one or a few workers, and the
+ * others only get work by stealing it, under the lock of the victim's queue alone (see MultiQueuePolicy.h):
+ *   one spawner - a single thread spawns all JOBS jobs
+ *   recursive   - every job spawns up to two more jobs from a shared budget before it works, JOBS in all
+ *   skewed      - a single thread spawns the jobs, every SKEW-th of which does SKEW times the work
+ * For every pattern and worker count prints the wall-clock time until the last job finished and the speedup over one
+ * worker, which is bounded by the cores the process gets. N is the number of online CPUs, or the first argument.
+ * Each run is a child process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOBS 64
+#define WORK 10000000L
+#define SKEW 4
+
+enum Pattern { ONE_SPAWNER, RECURSIVE, SKEWED };
+
+static const char* pattern_names[] = {"one spawner", "recursive", "skewed"};
+
+static Pattern pattern;
+static std::atomic<int> finished(0);
+static std::atomic<int> budget(0);
+static volatile unsigned long sink[MAX_THREAD_NUM];
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void job()
+{
+    int tid = uthread_get_tid();
+    if (pattern == RECURSIVE) {
+        for (int i = 0; i < 2 && budget.fetch_sub(1) > 0; i++) {
+            uthread_spawn(job);
+        }
+    }
+    long work = pattern == SKEWED && tid % SKEW == 0 ? WORK * SKEW : WORK;
+    unsigned long x = tid;
+    for (long i = 0; i < work; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    sink[tid] = x;
+    finished++;
+    uthread_terminate(tid);
+}
+
+static void spawner()
+{
+    for (int i = 0; i < JOBS; i++) {
+        uthread_spawn(job);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+// Returns the elapsed time in ms, or a negative value if the run failed
+static double run(Pattern run_pattern, int workers)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        pattern = run_pattern;
+        uthread_options options = {};
+        options.quantum_usecs = 10000;
+        options.workers = workers;
+        double elapsed = -1;
+        if (uthread_init_ex(&options) == 0) {
+            double start = now_ns();
+            if (pattern == RECURSIVE) {
+                budget = JOBS - 1;
+                uthread_spawn(job);
+            } else {
+                uthread_spawn(spawner);
+            }
+            while (finished < JOBS) {
+                uthread_yield();
+            }
+            elapsed = (now_ns() - start) / 1e6;
+        }
+        if (write(fds[1], &elapsed, sizeof(elapsed)) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    double elapsed = -1;
+    if (read(fds[0], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) {
+        elapsed = -1;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+    return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+    int max_workers = argc > 1 ? atoi(argv[1]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_workers < 1) {
+        max_workers = 1;
+    }
+    if (max_workers > UTHREAD_MAX_WORKERS) {
+        max_workers = UTHREAD_MAX_WORKERS;
+    }
+    printf("%d jobs, %ld steps each\n", JOBS, WORK);
+    printf("%-12s %8s %10s %8s\n", "pattern", "workers", "ms", "speedup");
+    for (int p = ONE_SPAWNER; p <= SKEWED; p++) {
+        double base = 0;
+        for (int workers = 1; workers <= max_workers; workers++) {
+            double elapsed = run((Pattern) p, workers);
+            if (elapsed < 0) {
+                printf("%-12s %8d %10s\n", pattern_names[p], workers, "failed");
+                continue;
+            }
+            if (workers == 1) {
+                base = elapsed;
+            }
+            printf("%-12s %8d %10.1f %8.2f\n", pattern_names[p], workers, elapsed, base / elapsed);
+        }
+    }
+    return 0;
+}
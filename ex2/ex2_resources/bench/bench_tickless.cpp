@@ -0,0 +1,55 @@
+/*
+ * bench_tickless.cpp - cost of the timer for a thread that runs alone.
+ *
+ * The main thread runs a fixed loop with no other thread in the library, with a 100 us quantum: with the periodic
+ * timer, where every quantum still ends with a SIGVTALRM that picks the same thread again, and in tickless mode, where
+ * the timer is stopped. Both are run on the process CPU time timer (which the kernel only advances on its scheduler
+ * tick, so it fires far less often than the quantum asks for) and on the wall-clock timer. Each run is a child
+ * process, since the library can only be initialized once.
+ */
+
+#include "uthreads.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUANTUM_USECS 100
+#define ITERATIONS 400000000L
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run(const char* name, int timer, int tickless)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = QUANTUM_USECS;
+        options.timer = timer;
+        options.tickless = tickless;
+        uthread_init_ex(&options);
+
+        double start = now_ns();
+        for (volatile long i = 0; i < ITERATIONS; i++) {
+        }
+        double elapsed = now_ns() - start;
+        printf("%-20s %10.1f ms %10d signals\n", name, elapsed / 1e6, uthread_get_total_quantums() - 1);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    run("virtual periodic", UTHREAD_TIMER_VIRTUAL, 0);
+    run("virtual tickless", UTHREAD_TIMER_VIRTUAL, 1);
+    run("monotonic periodic", UTHREAD_TIMER_MONOTONIC, 0);
+    run("monotonic tickless", UTHREAD_TIMER_MONOTONIC, 1);
+    return 0;
+}
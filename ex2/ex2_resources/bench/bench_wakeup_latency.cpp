@@ -0,0 +1,119 @@
+/*
+ * bench_wakeup_latency.cpp - wakeup-to-run latency of a regular against a latency-critical thread.
+ *
+ * SPINNERS threads spin while the main thread wakes a blocked thread SAMPLES times, each time after spinning for a
+ * random part of a quantum. The woken thread records the time from uthread_resume until it runs and blocks again.
+ *   regular          - the thread waits in the ready queue behind the spinning threads
+ *   latency-critical - uthread_attr.latency_critical: the thread preempts the main thread once it ran
+ *                      min_quantum_usecs (a quarter quantum) of its quantum
+ * and prints a histogram of the latencies and their percentiles. The timer ticks 4 times per quantum, so a deferred
+ * preemption is taken within a quarter quantum. Each run is a child process, since the library can only be
+ * initialized once.
+ */
+
+#include "uthreads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+#define QUANTUM_USECS 1000
+#define SPINNERS 4
+#define SAMPLES 500
+
+static const double BUCKETS_USECS[] = {5, 20, 100, 250, 500, 1000, 2000, 5000};
+#define BUCKET_COUNT ((int) (sizeof(BUCKETS_USECS) / sizeof(BUCKETS_USECS[0])))
+
+static volatile double woken_ns = 0;
+static volatile int samples = 0;
+static double latencies_usecs[SAMPLES];
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+static void waiter()
+{
+    for (;;) {
+        latencies_usecs[samples] = (now_ns() - woken_ns) / 1e3;
+        samples = samples + 1;
+        uthread_block(uthread_get_tid());
+    }
+}
+
+static void run(bool latency_critical)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = QUANTUM_USECS;
+        options.timer = UTHREAD_TIMER_MONOTONIC;
+        options.timer_ticks = 4;
+        uthread_init_ex(&options);
+        uthread_attr attrs = {};
+        attrs.latency_critical = latency_critical;
+        int tid = uthread_spawn_ex(waiter, &attrs);
+        uthread_block(tid); // it first runs when it is woken
+        for (int i = 0; i < SPINNERS; i++) {
+            uthread_spawn(spin);
+        }
+
+        srand(1);
+        while (samples < SAMPLES) {
+            double until = now_ns() + rand() % QUANTUM_USECS * 1e3;
+            while (now_ns() < until) {
+            }
+            int sample = samples;
+            woken_ns = now_ns();
+            uthread_resume(tid);
+            while (samples == sample) {
+            }
+        }
+
+        std::sort(latencies_usecs, latencies_usecs + SAMPLES);
+        int counts[BUCKET_COUNT + 1] = {};
+        for (double latency : latencies_usecs) {
+            int bucket = 0;
+            while (bucket < BUCKET_COUNT && latency >= BUCKETS_USECS[bucket]) {
+                bucket++;
+            }
+            counts[bucket]++;
+        }
+        printf("%-16s", latency_critical ? "latency-critical" : "regular");
+        for (int count : counts) {
+            printf(" %6d", count);
+        }
+        printf(" %8.1f %8.1f %8.1f\n", latencies_usecs[SAMPLES / 2], latencies_usecs[SAMPLES * 99 / 100],
+               latencies_usecs[SAMPLES - 1]);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    printf("%-16s", "thread");
+    for (double bucket : BUCKETS_USECS) {
+        printf(" %6s", ("<" + std::to_string((int) bucket)).c_str());
+    }
+    printf(" %6s %8s %8s %8s\n", ">=", "p50", "p99", "max");
+    run(false);
+    run(true);
+    printf("latencies in micro-seconds, histogram buckets by upper bound\n");
+    return 0;
+}
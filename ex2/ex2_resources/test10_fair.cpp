@@ -0,0 +1,69 @@
+/*
+ * test10.cc - Fair scheduling. The main thread and a spin with the default weight, b spins with twice the weight and
+ * c with four times the weight. Every quantum is a full timer quantum, so once the main thread got its quantums the
+ * others should have got about 1, 2 and 4 times as many. The default timer counts CPU time, and the threads are
+ * charged the CPU time of the worker as well, so every quantum is worth the same time even when other processes take
+ * the CPU.
+ *
+ * Output should be:
+ * test10:
+ * --------------
+ * thread library error: weight must not be negative
+ * shares are within 20% of 1:1:2:4
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "uthreads.h"
+
+#define QUANTUMS 25
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+bool near(int quantums, int expected)
+{
+    return abs(quantums - expected) * 5 <= expected;
+}
+
+int main()
+{
+    printf("test10:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 5000;
+    options.policy = UTHREAD_POLICY_FAIR;
+    uthread_init_ex(&options);
+
+    uthread_attr attrs = {};
+    attrs.weight = -1;
+    uthread_spawn_ex(spin, &attrs);
+
+    int a = uthread_spawn(spin);
+    attrs.weight = 2 * UTHREAD_DEFAULT_WEIGHT;
+    int b = uthread_spawn_ex(spin, &attrs);
+    attrs.weight = 4 * UTHREAD_DEFAULT_WEIGHT;
+    int c = uthread_spawn_ex(spin, &attrs);
+
+    while (uthread_get_quantums(0) < QUANTUMS) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+    int main_quantums = uthread_get_quantums(0);
+    int qa = uthread_get_quantums(a);
+    int qb = uthread_get_quantums(b);
+    int qc = uthread_get_quantums(c);
+    if (near(qa, main_quantums) && near(qb, 2 * main_quantums) && near(qc, 4 * main_quantums)) {
+        printf("shares are within 20%% of 1:1:2:4\n");
+    } else {
+        printf("shares are off: %d %d %d %d\n", main_quantums, qa, qb, qc);
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * test11.cc - Deadline threads. Two spinning threads and the spinning main thread would keep d waiting for two
+ * quantums of 10 ms each time, but d has a job every 5 ms and its jobs preempt them, so each of its 20 jobs of about
+ * 0.2 ms is done long before its deadline. A second deadline thread that would need 90% of the CPU on top of d's 50%
+ * is not admitted.
+ *
+ * Output should be:
+ * test11:
+ * --------------
+ * thread library error: runtime must fit in the deadline, and the deadline in the period
+ * thread library error: the calling thread has no deadline
+ * thread library error: deadline threads would need more than the whole CPU
+ * d: 20 jobs, 0 misses
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define JOBS 20
+
+volatile bool done = false;
+
+double now_usecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+void d()
+{
+    for (int job = 0; job < JOBS; job++) {
+        double start = now_usecs();
+        while (now_usecs() - start < 200) {
+        }
+        uthread_wait_period();
+    }
+    done = true;
+    uthread_block(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test11:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 10000;
+    options.timer = UTHREAD_TIMER_MONOTONIC;
+    options.timer_ticks = 20;
+    uthread_init_ex(&options);
+
+    uthread_spawn(spin);
+    uthread_spawn(spin);
+    int tid = uthread_spawn(d);
+
+    uthread_deadline params = {};
+    params.runtime_usecs = 6000;
+    params.period_usecs = 5000;
+    uthread_set_deadline(tid, &params);
+    uthread_wait_period();
+
+    params.runtime_usecs = 2500;
+    uthread_set_deadline(tid, &params);
+    params.runtime_usecs = 4500;
+    uthread_set_deadline(uthread_spawn(spin), &params);
+
+    while (!done) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+    printf("d: %d jobs, %d misses\n", JOBS, uthread_get_deadline_misses(tid));
+    uthread_terminate(0);
+    return 0;
+}
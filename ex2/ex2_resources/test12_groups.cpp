@@ -0,0 +1,94 @@
+/*
+ * test12.cc - Thread groups. Group a has one spinning thread, group b has six, and group c has two but a quota of
+ * 10 ms per 100 ms; the spinning main thread is in group 0. All groups have the same shares, so c gets its 10% of the
+ * CPU and the three others about 30% each, however many threads they have.
+ *
+ * Output should be:
+ * test12:
+ * --------------
+ * thread library error: no such group
+ * thread library error: shares, quota_usecs and period_usecs must not be negative
+ * group c got its quota
+ * groups 0, a and b got the same share
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "uthreads.h"
+
+#define TOTAL_USECS 600000
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+void spawn_in(int group, int n)
+{
+    uthread_attr attrs = {};
+    attrs.group = group;
+    for (int i = 0; i < n; i++) {
+        uthread_spawn_ex(spin, &attrs);
+    }
+}
+
+bool near(long long usage, long long expected)
+{
+    return llabs(usage - expected) * 5 <= expected;
+}
+
+int main()
+{
+    printf("test12:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 5000;
+    options.timer = UTHREAD_TIMER_MONOTONIC;
+    options.timer_ticks = 5;
+    uthread_init_ex(&options);
+
+    uthread_attr attrs = {};
+    attrs.group = 1;
+    uthread_spawn_ex(spin, &attrs);
+    uthread_group_attr group_attrs = {};
+    group_attrs.shares = -1;
+    uthread_group_create(&group_attrs);
+
+    int a = uthread_group_create(nullptr);
+    int b = uthread_group_create(nullptr);
+    group_attrs.shares = 0;
+    group_attrs.quota_usecs = 10000;
+    int c = uthread_group_create(&group_attrs);
+    spawn_in(a, 1);
+    spawn_in(b, 6);
+    spawn_in(c, 2);
+
+    long long total;
+    do {
+        total = uthread_group_get_usage(0) + uthread_group_get_usage(a) + uthread_group_get_usage(b) +
+                uthread_group_get_usage(c);
+    } while (total < TOTAL_USECS);
+
+    long long usage_c = uthread_group_get_usage(c);
+    // 10 ms in each of the 6 or 7 periods the run overlaps, overrun by up to a timer tick each
+    if (usage_c >= 50000 && usage_c <= 80000) {
+        printf("group c got its quota\n");
+    } else {
+        printf("group c got %lld of %lld usecs\n", usage_c, total);
+    }
+    long long share = (total - usage_c) / 3;
+    long long usage_0 = uthread_group_get_usage(0);
+    long long usage_a = uthread_group_get_usage(a);
+    long long usage_b = uthread_group_get_usage(b);
+    if (near(usage_0, share) && near(usage_a, share) && near(usage_b, share)) {
+        printf("groups 0, a and b got the same share\n");
+    } else {
+        printf("groups got %lld %lld %lld usecs\n", usage_0, usage_a, usage_b);
+    }
+    uthread_terminate(0);
+    return 0;
+}
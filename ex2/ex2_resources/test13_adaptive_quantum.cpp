@@ -0,0 +1,73 @@
+/*
+ * test13.cc - Adaptive quantum with a target latency of 8 ms. With two spinning threads (the main thread and one more)
+ * each quantum is 4 ms; with eight it is 1 ms, so in the same time there are about four times as many quantums.
+ *
+ * Output should be:
+ * test13:
+ * --------------
+ * thread library error: min_quantum_usecs must not be above max_quantum_usecs
+ * the quantum got shorter with more threads
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define PHASE_USECS 200000
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+double now_usecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Quantums that start while the main thread spins for PHASE_USECS
+int quantums_in_phase()
+{
+    int first = uthread_get_total_quantums();
+    double start = now_usecs();
+    while (now_usecs() - start < PHASE_USECS) {
+    }
+    return uthread_get_total_quantums() - first;
+}
+
+int main()
+{
+    printf("test13:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 2000;
+    options.timer = UTHREAD_TIMER_MONOTONIC;
+    options.adaptive_quantum = 1;
+    options.min_quantum_usecs = 9000;
+    options.max_quantum_usecs = 8000;
+    uthread_init_ex(&options);
+
+    options.min_quantum_usecs = 500;
+    options.target_latency_usecs = 8000;
+    uthread_init_ex(&options);
+
+    uthread_spawn(spin);
+    int two = quantums_in_phase();
+    for (int i = 0; i < 6; i++) {
+        uthread_spawn(spin);
+    }
+    int eight = quantums_in_phase();
+    if (eight > 3 * two) {
+        printf("the quantum got shorter with more threads\n");
+    } else {
+        printf("%d quantums with two threads, %d with eight\n", two, eight);
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * test14.cc - Per-thread quantums. Two spinning threads take turns with the spinning main thread: one with a quantum of
+ * its own of 1 ms, one with the default quantum of 8 ms. Both start as many quantums, but the one with the long
+ * quantum runs several times longer. Then the default quantum is set to 1 ms and the first thread's to 8 ms, which
+ * turns it around without a restart.
+ *
+ * Output should be:
+ * test14:
+ * --------------
+ * thread library error: quantum_usecs must not be negative
+ * thread library error: quantum_usecs must be positive
+ * thread library error: thread id is null
+ * the thread with the long quantum ran longer
+ * the thread with the long quantum ran longer after the change
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define PHASE_USECS 300000
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+double now_usecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Runs the main thread for PHASE_USECS and checks that the thread with ID longer ran several times longer than the
+// thread with ID shorter, in about as many quantums
+void phase(int shorter, int longer, const char* message)
+{
+    long long short_usecs = uthread_get_run_usecs(shorter);
+    long long long_usecs = uthread_get_run_usecs(longer);
+    int short_quantums = uthread_get_quantums(shorter);
+    int long_quantums = uthread_get_quantums(longer);
+    double start = now_usecs();
+    while (now_usecs() - start < PHASE_USECS) {
+    }
+    short_usecs = uthread_get_run_usecs(shorter) - short_usecs;
+    long_usecs = uthread_get_run_usecs(longer) - long_usecs;
+    short_quantums = uthread_get_quantums(shorter) - short_quantums;
+    long_quantums = uthread_get_quantums(longer) - long_quantums;
+    if (long_usecs > 3 * short_usecs && abs(long_quantums - short_quantums) <= 2) {
+        printf("%s\n", message);
+    } else {
+        printf("%lld us in %d quantums with the short quantum, %lld us in %d with the long one\n", short_usecs,
+               short_quantums, long_usecs, long_quantums);
+    }
+}
+
+int main()
+{
+    printf("test14:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 8000;
+    options.timer = UTHREAD_TIMER_MONOTONIC;
+    uthread_init_ex(&options);
+
+    int first = uthread_spawn(spin);
+    int second = uthread_spawn(spin);
+    uthread_set_quantum(first, -1);
+    uthread_set_default_quantum(0);
+    uthread_get_run_usecs(5);
+
+    uthread_set_quantum(first, 1000);
+    phase(first, second, "the thread with the long quantum ran longer");
+
+    uthread_set_default_quantum(1000);
+    uthread_set_quantum(first, 8000);
+    phase(second, first, "the thread with the long quantum ran longer after the change");
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * test15.cc - Wakeup preemption. Two threads block themselves every time they run, while two more spin. The main
+ * thread resumes both: the latency-critical one runs before uthread_resume returns, the regular one waits behind the
+ * spinning threads for its turn.
+ *
+ * Output should be:
+ * test15:
+ * --------------
+ * the latency-critical thread ran right away
+ * the regular thread waited for its turn
+ *
+ */
+
+#include <stdio.h>
+#include "uthreads.h"
+
+volatile int urgent_runs = 0;
+volatile int regular_runs = 0;
+
+void spin()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+void urgent()
+{
+    for (;;) {
+        urgent_runs++;
+        uthread_block(uthread_get_tid());
+    }
+}
+
+void regular()
+{
+    for (;;) {
+        regular_runs++;
+        uthread_block(uthread_get_tid());
+    }
+}
+
+int main()
+{
+    printf("test15:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 10000;
+    options.timer = UTHREAD_TIMER_MONOTONIC;
+    options.min_quantum_usecs = 1;
+    uthread_init_ex(&options);
+
+    uthread_attr attrs = {};
+    attrs.latency_critical = 1;
+    int urgent_tid = uthread_spawn_ex(urgent, &attrs);
+    int regular_tid = uthread_spawn(regular);
+    uthread_spawn(spin);
+    uthread_spawn(spin);
+    while (urgent_runs == 0 || regular_runs == 0) {
+    }
+
+    uthread_resume(urgent_tid);
+    if (urgent_runs == 2) {
+        printf("the latency-critical thread ran right away\n");
+    } else {
+        printf("the latency-critical thread did not run\n");
+    }
+    uthread_resume(regular_tid);
+    if (regular_runs == 1) {
+        printf("the regular thread waited for its turn\n");
+    } else {
+        printf("the regular thread ran right away\n");
+    }
+    while (regular_runs == 1) {
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * test16.cc - Cooperative switches with a quantum far too long to be preempted. Three threads print their ID and
+ * yield; the main thread hands its quantum to the last one, which runs before the other two. Then two threads pass
+ * the CPU back and forth with uthread_yield_to while the main thread yields, each switch being a new quantum.
+ *
+ * Output should be:
+ * test16:
+ * --------------
+ * thread library error: a thread can't yield to itself
+ * thread library error: thread is not ready
+ * 3
+ * 1
+ * 2
+ * total quantums: 5
+ * ping 0
+ * pong 0
+ * ping 1
+ * pong 1
+ * ping 2
+ * pong 2
+ * total quantums: 15
+ *
+ */
+
+#include <stdio.h>
+#include "uthreads.h"
+
+#define ROUNDS 3
+
+int ping_tid = -1;
+int pong_tid = -1;
+volatile bool done = false;
+
+void print_and_yield()
+{
+    printf("%d\n", uthread_get_tid());
+    uthread_yield();
+    uthread_terminate(uthread_get_tid());
+}
+
+void ping()
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        printf("ping %d\n", i);
+        uthread_yield_to(pong_tid);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+void pong()
+{
+    for (int i = 0; i < ROUNDS; i++) {
+        printf("pong %d\n", i);
+        if (i < ROUNDS - 1) {
+            uthread_yield_to(ping_tid);
+        }
+    }
+    done = true;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test16:\n--------------\n");
+    uthread_init(100000000);
+
+    uthread_yield_to(0);
+    int first = uthread_spawn(print_and_yield);
+    uthread_block(first);
+    uthread_yield_to(first);
+    uthread_resume(first);
+    uthread_spawn(print_and_yield);
+    int last = uthread_spawn(print_and_yield);
+    uthread_yield_to(last);
+    printf("total quantums: %d\n", uthread_get_total_quantums());
+
+    ping_tid = uthread_spawn(ping);
+    pong_tid = uthread_spawn(pong);
+    while (!done) {
+        uthread_yield();
+    }
+    printf("total quantums: %d\n", uthread_get_total_quantums());
+    uthread_terminate(0);
+    return 0;
+}
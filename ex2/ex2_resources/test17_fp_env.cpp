@@ -0,0 +1,78 @@
+/*
+ * test17.cc - Floating-point environments across switches. Two threads with uthread_attr.fp_env set round upward
+ * and downward, and a regular thread expects the default rounding; all three divide 1 by 3 and yield, over and over,
+ * with a quantum long enough that every switch is a yield. Each one still gets its own rounding when it runs again.
+ *
+ * Output should be:
+ * test17:
+ * --------------
+ * upward: ok
+ * downward: ok
+ * to nearest: ok
+ *
+ */
+
+#include <fenv.h>
+#include <stdio.h>
+#include "uthreads.h"
+
+#define ROUNDS 100
+
+volatile double one = 1;
+volatile double minus_one = -1;
+volatile double three = 3;
+volatile int finished = 0;
+
+// Checks ROUNDS times, yielding in between, that the thread runs with the given rounding
+void run(int rounding, const char* name)
+{
+    int errors = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        // 1/3 and -1/3 round to the same magnitude only to nearest; upward the positive one is bigger
+        double third = one / three;
+        double minus_third = minus_one / three;
+        if (fegetround() != rounding || (rounding == FE_UPWARD && third <= -minus_third) ||
+            (rounding == FE_DOWNWARD && third >= -minus_third) ||
+            (rounding == FE_TONEAREST && third != -minus_third)) {
+            errors++;
+        }
+        uthread_yield();
+    }
+    printf("%s: %s\n", name, errors == 0 ? "ok" : "wrong rounding");
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void upward()
+{
+    fesetround(FE_UPWARD);
+    run(FE_UPWARD, "upward");
+}
+
+void downward()
+{
+    fesetround(FE_DOWNWARD);
+    run(FE_DOWNWARD, "downward");
+}
+
+void to_nearest()
+{
+    run(FE_TONEAREST, "to nearest");
+}
+
+int main()
+{
+    printf("test17:\n--------------\n");
+    uthread_init(100000000);
+
+    uthread_attr attrs = {};
+    attrs.fp_env = 1;
+    uthread_spawn_ex(upward, &attrs);
+    uthread_spawn_ex(downward, &attrs);
+    uthread_spawn(to_nearest);
+    while (finished < 3) {
+        uthread_yield();
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * test18.cc - M:N mode. Eight spinning threads on four workers must run on several kernel threads; then the main
+ * thread blocks, resumes and terminates one of them while it may run on another worker, and checks that it stops,
+ * runs again and stops for good. The first two calls are invalid options.
+ *
+ * Output should be:
+ * test18:
+ * --------------
+ * thread library error: workers must not be negative or above 64
+ * thread library error: several workers only run the round robin policy, without tickless mode
+ * spinners ran on several kernel threads
+ * blocked thread stopped
+ * resumed thread runs again
+ * terminated thread stopped
+ * thread library error: thread id is null
+ *
+ */
+
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define WORKERS 4
+#define SPINNERS 8
+#define WAIT_QUANTUMS 20
+
+volatile long progress[SPINNERS + 1];
+volatile long kernel_thread[SPINNERS + 1];
+
+void spin()
+{
+    int tid = uthread_get_tid();
+    for (;;) {
+        kernel_thread[tid] = syscall(SYS_gettid);
+        progress[tid]++;
+    }
+}
+
+void wait_quantums(int quantums)
+{
+    int target = uthread_get_total_quantums() + quantums;
+    while (uthread_get_total_quantums() < target) {
+    }
+}
+
+// Whether the thread makes no progress over a few quantums, once the block or terminate reached its worker
+bool stopped(int tid)
+{
+    wait_quantums(WAIT_QUANTUMS);
+    long before = progress[tid];
+    wait_quantums(WAIT_QUANTUMS);
+    return progress[tid] == before;
+}
+
+int main()
+{
+    printf("test18:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.workers = UTHREAD_MAX_WORKERS + 1;
+    uthread_init_ex(&options);
+    options.workers = WORKERS;
+    options.policy = UTHREAD_POLICY_MLFQ;
+    uthread_init_ex(&options);
+    options.policy = UTHREAD_POLICY_RR;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < SPINNERS; i++) {
+        uthread_spawn(spin);
+    }
+    for (int tid = 1; tid <= SPINNERS; tid++) {
+        while (progress[tid] == 0) {
+        }
+    }
+    bool several = false;
+    for (int tid = 2; tid <= SPINNERS; tid++) {
+        several = several || kernel_thread[tid] != kernel_thread[1];
+    }
+    printf("spinners ran on %s\n", several ? "several kernel threads" : "a single kernel thread");
+
+    int tid = SPINNERS;
+    uthread_block(tid);
+    printf("blocked thread %s\n", stopped(tid) ? "stopped" : "still runs");
+    uthread_resume(tid);
+    long before = progress[tid];
+    while (progress[tid] == before) {
+    }
+    printf("resumed thread runs again\n");
+    uthread_terminate(tid);
+    printf("terminated thread %s\n", stopped(tid) ? "stopped" : "still runs");
+    // with several workers library errors bypass the stdout buffer
+    fflush(stdout);
+    uthread_get_quantums(tid);
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * test19.cc - Work stealing in M:N mode. A single thread spawns all the jobs, which are queued on its own worker: the
+ * other three workers must steal them, so the jobs run on several kernel threads. Then a thread sleeps while the
+ * workers around it are parked, and must still be woken up on time.
+ *
+ * Output should be:
+ * test19:
+ * --------------
+ * jobs ran on several kernel threads
+ * all 16 jobs done
+ * sleeper woke up
+ *
+ */
+
+#include <atomic>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define WORKERS 4
+#define JOBS 16
+#define WORK 20000000L
+
+std::atomic<int> done(0);
+volatile long kernel_thread[JOBS + 2];
+volatile unsigned long sink[JOBS + 2];
+volatile bool woke = false;
+
+void job()
+{
+    int tid = uthread_get_tid();
+    kernel_thread[tid] = syscall(SYS_gettid);
+    unsigned long x = tid;
+    for (long i = 0; i < WORK; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    sink[tid] = x;
+    done++;
+    uthread_terminate(tid);
+}
+
+void spawner()
+{
+    for (int i = 0; i < JOBS; i++) {
+        uthread_spawn(job);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+void sleeper()
+{
+    uthread_sleep(5);
+    woke = true;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test19:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.workers = WORKERS;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+
+    int first = uthread_spawn(spawner) + 1;
+    while (done < JOBS) {
+        uthread_yield();
+    }
+    bool several = false;
+    for (int tid = first + 1; tid < first + JOBS; tid++) {
+        several = several || kernel_thread[tid] != kernel_thread[first];
+    }
+    printf("jobs ran on %s\n", several ? "several kernel threads" : "a single kernel thread");
+    printf("all %d jobs done\n", JOBS);
+
+    uthread_spawn(sleeper);
+    while (!woke) {
+        uthread_yield();
+    }
+    printf("sleeper woke up\n");
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * test20.cc - Requests posted from a pthread outside the library. A listener pthread resumes a blocked thread and
+ * spawns three handlers through the inbox while the main thread spins alone in tickless mode, with the timer stopped,
+ * so the post itself has to get the scheduler's attention. The first call is made before uthread_init_ex, the last
+ * two are invalid requests.
+ *
+ * Output should be:
+ * test20:
+ * --------------
+ * thread library error: the library is not initialized
+ * thread library error: out of bounds thread id [0-99 only]
+ * thread library error: entry_point is null
+ * waiter resumed
+ * 3 handlers ran
+ *
+ */
+
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include "uthreads.h"
+
+#define HANDLERS 3
+
+int waiter_tid;
+std::atomic<bool> waiting(false);
+std::atomic<bool> resumed(false);
+std::atomic<int> handled(0);
+
+void waiter()
+{
+    waiting = true;
+    uthread_block(uthread_get_tid());
+    resumed = true;
+    uthread_terminate(uthread_get_tid());
+}
+
+void handler()
+{
+    handled++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void* listener(void*)
+{
+    uthread_post_resume(waiter_tid);
+    for (int i = 0; i < HANDLERS; i++) {
+        uthread_post_spawn(handler);
+    }
+    uthread_post_resume(MAX_THREAD_NUM);
+    uthread_post_spawn(nullptr);
+    return nullptr;
+}
+
+int main()
+{
+    printf("test20:\n--------------\n");
+
+    uthread_post_spawn(handler);
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.tickless = 1;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+
+    waiter_tid = uthread_spawn(waiter);
+    while (!waiting) {
+        uthread_yield();
+    }
+    // let the waiter block, after which the main thread runs alone
+    uthread_yield();
+
+    // the listener must not take the timer signal of the library
+    sigset_t timer_signal, old_mask;
+    sigemptyset(&timer_signal);
+    sigaddset(&timer_signal, SIGVTALRM);
+    pthread_sigmask(SIG_BLOCK, &timer_signal, &old_mask);
+    pthread_t thread;
+    pthread_create(&thread, nullptr, &listener, nullptr);
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+    // no library call, only the posts can wake the scheduler up
+    while (!resumed || handled < HANDLERS) {
+    }
+    pthread_join(thread, nullptr);
+    printf("waiter resumed\n");
+    printf("%d handlers ran\n", handled.load());
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * test21.cc - Thread affinity in M:N mode. Six spinners run on four workers; two of them are then bound to worker 2
+ * and one to worker 3. Once they moved there, each of them must stay on one kernel thread without migrating, the two
+ * on worker 2 on the same one, and the one on worker 3 on another. Binding the main thread to worker 1 must move it
+ * off the calling kernel thread right away. The first three calls are invalid.
+ *
+ * Output should be:
+ * test21:
+ * --------------
+ * thread library error: the affinity has none of the workers
+ * thread library error: the affinity has none of the workers
+ * thread library error: thread id is null
+ * bound threads stay on one kernel thread
+ * threads bound to the same worker share it
+ * threads bound to different workers don't
+ * bound threads didn't migrate
+ * main thread moved to another worker
+ *
+ */
+
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define WORKERS 4
+#define SPINNERS 6
+#define WAIT_QUANTUMS 20
+
+volatile long progress[SPINNERS + 1];
+volatile long kernel_thread[SPINNERS + 1];
+volatile bool changed[SPINNERS + 1];
+
+void spin()
+{
+    int tid = uthread_get_tid();
+    for (;;) {
+        long current = syscall(SYS_gettid);
+        if (current != kernel_thread[tid]) {
+            kernel_thread[tid] = current;
+            changed[tid] = true;
+        }
+        progress[tid]++;
+    }
+}
+
+void wait_quantums(int quantums)
+{
+    int target = uthread_get_total_quantums() + quantums;
+    while (uthread_get_total_quantums() < target) {
+    }
+}
+
+int main()
+{
+    printf("test21:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.workers = WORKERS;
+    options.pin_workers = 1;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+    // with several workers library errors bypass the stdout buffer
+    fflush(stdout);
+    uthread_set_affinity(0, 0);
+    uthread_set_affinity(0, 1ULL << WORKERS);
+    uthread_get_migrations(SPINNERS + 1);
+
+    for (int i = 0; i < SPINNERS; i++) {
+        uthread_spawn(spin);
+    }
+    for (int tid = 1; tid <= SPINNERS; tid++) {
+        while (progress[tid] == 0) {
+        }
+    }
+    uthread_set_affinity(1, 1ULL << 2);
+    uthread_set_affinity(2, 1ULL << 2);
+    uthread_set_affinity(3, 1ULL << 3);
+    // a bound thread that was running moves at the end of its quantum
+    wait_quantums(WAIT_QUANTUMS);
+
+    int migrations[4];
+    for (int tid = 1; tid <= 3; tid++) {
+        changed[tid] = false;
+        migrations[tid] = uthread_get_migrations(tid);
+    }
+    long before = progress[1] + progress[2] + progress[3];
+    wait_quantums(WAIT_QUANTUMS * 2);
+    while (progress[1] + progress[2] + progress[3] == before) {
+    }
+
+    printf("bound threads %s\n", changed[1] || changed[2] || changed[3] ? "changed kernel threads"
+                                                                       : "stay on one kernel thread");
+    printf("threads bound to the same worker %s\n", kernel_thread[1] == kernel_thread[2] ? "share it" : "don't");
+    printf("threads bound to different workers %s\n", kernel_thread[1] != kernel_thread[3] ? "don't" : "share it");
+    bool migrated = false;
+    for (int tid = 1; tid <= 3; tid++) {
+        migrated = migrated || uthread_get_migrations(tid) != migrations[tid];
+    }
+    printf("bound threads %s\n", migrated ? "migrated" : "didn't migrate");
+
+    uthread_set_affinity(0, 1ULL << 1);
+    bool moved = syscall(SYS_gettid) != getpid() && uthread_get_migrations(0) > 0;
+    printf("main thread %s\n", moved ? "moved to another worker" : "stayed on worker 0");
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * test22.cc - NUMA placement in M:N mode with two pinned workers. The main thread, bound to worker 0, and a spawner
+ * thread bound to worker 1 spawn four threads each, which look up the NUMA policy of their stack (get_mempolicy). It
+ * must prefer the node of the CPU of the worker that spawned the thread. A second round does the same again once the
+ * threads of the first terminated, so that it gets its threads recycled from the pool.
+ *
+ * Output should be:
+ * test22:
+ * --------------
+ * threads spawned on worker 0 have their stacks on its node
+ * threads spawned on worker 1 have their stacks on its node
+ * recycled threads have their stacks on the node of their spawner
+ * 16 threads ran
+ *
+ */
+
+#include <atomic>
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define THREADS 4
+#define MAX_NODES 64
+
+int spawner_node[MAX_THREAD_NUM];
+int stack_node[MAX_THREAD_NUM];
+int spawned_by[MAX_THREAD_NUM]; // the worker of the spawner
+std::atomic<int> ran(0);
+std::atomic<bool> spawner_done(false);
+
+int current_node()
+{
+    unsigned int cpu, node;
+    syscall(SYS_getcpu, &cpu, &node, nullptr);
+    return (int) node;
+}
+
+// The node the memory at addr prefers, -1 if it has no preferred node
+int preferred_node(void* addr)
+{
+    int mode;
+    unsigned long mask = 0;
+    if (syscall(SYS_get_mempolicy, &mode, &mask, (unsigned long) MAX_NODES + 1, addr, MPOL_F_ADDR) < 0 ||
+        mode != MPOL_PREFERRED || mask == 0 || (mask & (mask - 1)) != 0) {
+        return -1;
+    }
+    return __builtin_ctzl(mask);
+}
+
+void child()
+{
+    int local = 0;
+    stack_node[uthread_get_tid()] = preferred_node(&local);
+    ran++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void spawn_children(int worker)
+{
+    for (int i = 0; i < THREADS; i++) {
+        int tid = uthread_spawn(child);
+        spawner_node[tid] = current_node();
+        spawned_by[tid] = worker;
+    }
+}
+
+void spawner()
+{
+    uthread_set_affinity(uthread_get_tid(), 1ULL << 1);
+    spawn_children(1);
+    spawner_done = true;
+    uthread_terminate(uthread_get_tid());
+}
+
+// Spawns the threads of a round and waits until they ran, ran counts target threads then
+void run_round(int target)
+{
+    for (int tid = 0; tid < MAX_THREAD_NUM; tid++) {
+        spawned_by[tid] = -1;
+    }
+    spawner_done = false;
+    uthread_spawn(spawner);
+    spawn_children(0);
+    while (ran < target || !spawner_done) {
+        uthread_yield();
+    }
+}
+
+// Whether every thread of the last round spawned on worker (any worker for -1) had its stack on its spawner's node
+bool placed(int worker)
+{
+    bool result = true;
+    for (int tid = 1; tid < MAX_THREAD_NUM; tid++) {
+        if (spawned_by[tid] >= 0 && (worker < 0 || spawned_by[tid] == worker)) {
+            result = result && stack_node[tid] == spawner_node[tid];
+        }
+    }
+    return result;
+}
+
+int main()
+{
+    printf("test22:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.workers = 2;
+    options.pin_workers = 1;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+    uthread_set_affinity(0, 1ULL << 0);
+
+    run_round(2 * THREADS);
+    for (int worker = 0; worker < 2; worker++) {
+        printf("threads spawned on worker %d %s\n", worker, placed(worker) ? "have their stacks on its node"
+                                                                          : "have their stacks elsewhere");
+    }
+    run_round(4 * THREADS);
+    printf("recycled threads %s\n", placed(-1) ? "have their stacks on the node of their spawner"
+                                               : "have their stacks elsewhere");
+    printf("%d threads ran\n", ran.load());
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * test23.cc - Stack size and guard page of uthread_spawn_ex. A child process spawns a thread with a stack_size that is
+ * not a whole number of pages, and the thread recurses until it runs off its stack. The child must die of SIGSEGV
+ * after the library wrote the stack overflow diagnostic for that thread to stderr, reporting a stack of whole pages
+ * at least as big as requested, all of which the thread could use before it hit the guard page. The first call has a
+ * negative stack_size.
+ *
+ * Output should be:
+ * test23:
+ * --------------
+ * thread library error: stack_size must not be negative
+ * overflow reported for thread 1
+ * reported stack size is whole pages, at least the requested size
+ * the thread used the requested size before the guard page
+ * the process died of SIGSEGV
+ *
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define REQUESTED_STACK 10000
+#define FRAME 512
+
+// Shared with the child, which dies of the overflow
+volatile long* deepest;
+char* stack_start;
+
+void recurse(int depth)
+{
+    volatile char frame[FRAME];
+    frame[0] = (char) depth;
+    long used = stack_start - (char*) frame;
+    if (used > *deepest) {
+        *deepest = used;
+    }
+    recurse(depth + 1);
+    frame[1] = 0; // keeps the call from becoming a jump
+}
+
+void overflow()
+{
+    char start;
+    stack_start = &start;
+    recurse(0);
+}
+
+int main()
+{
+    printf("test23:\n--------------\n");
+    uthread_init(1000000);
+    uthread_attr attr = {};
+    attr.stack_size = -1;
+    uthread_spawn_ex(overflow, &attr);
+
+    deepest = (volatile long*) mmap(nullptr, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int fds[2];
+    if (deepest == MAP_FAILED || pipe(fds) < 0) {
+        return 1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        dup2(fds[1], STDERR_FILENO);
+        attr.stack_size = REQUESTED_STACK;
+        uthread_spawn_ex(overflow, &attr);
+        for (;;) {
+            uthread_yield();
+        }
+    }
+    close(fds[1]);
+    char diagnostic[256] = {};
+    size_t length = 0;
+    ssize_t n;
+    while (length < sizeof(diagnostic) - 1 &&
+           (n = read(fds[0], diagnostic + length, sizeof(diagnostic) - 1 - length)) > 0) {
+        length += n;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    int tid = -1;
+    size_t stack_size = 0;
+    sscanf(diagnostic, "thread library error: stack overflow in thread %d (stack size %zu bytes)", &tid, &stack_size);
+    printf("overflow reported for thread %d\n", tid);
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    bool whole_pages = stack_size % page == 0 && stack_size >= REQUESTED_STACK;
+    printf("reported stack size %s\n", whole_pages ? "is whole pages, at least the requested size"
+                                                  : "is wrong");
+    printf("the thread %s before the guard page\n", *deepest >= REQUESTED_STACK ? "used the requested size"
+                                                                                : "ran out of stack");
+    printf("the process %s\n", WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV ? "died of SIGSEGV"
+                                                                                   : "didn't die of SIGSEGV");
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * test24.cc - The floating-point environment of uthread_init under preemption. The process rounds toward zero before
+ * uthread_init, so every thread without uthread_attr.fp_env should round toward zero as well. Two such threads spin
+ * and sleep for a quantum now and then, so they are switched to from the timer handler both after a preemption and
+ * after a sleep, and threads spawned meanwhile first run from the handler too. A thread with fp_env set rounds upward
+ * all along. The kernel resets the rounding on entry to a signal handler, so none of this may leak into the others.
+ *
+ * Output should be:
+ * test24:
+ * --------------
+ * toward zero: ok
+ * toward zero: ok
+ * upward: ok
+ * spawned: ok
+ * main: ok
+ *
+ */
+
+#include <fenv.h>
+#include <stdio.h>
+#include "uthreads.h"
+
+#define QUANTUMS 300
+#define SPAWNED 20
+
+volatile double two = 2;
+volatile double three = 3;
+double toward_zero_third; // 2/3 rounded toward zero, it rounds up to nearest
+volatile int done = 0;
+volatile int finished = 0;
+volatile int spawned_errors = 0;
+volatile int spawned_finished = 0;
+
+bool rounds(int rounding)
+{
+    double third = two / three;
+    if (fegetround() != rounding) {
+        return false;
+    }
+    return rounding == FE_UPWARD ? third > toward_zero_third : third == toward_zero_third;
+}
+
+// Checks the rounding until main is done, sleeping for a quantum every sleep_every rounds (never for 0)
+void run(int rounding, const char* name, int sleep_every)
+{
+    int errors = 0;
+    for (long i = 1; !done; i++) {
+        if (!rounds(rounding)) {
+            errors++;
+        }
+        if (sleep_every > 0 && i % sleep_every == 0) {
+            uthread_sleep(1);
+        }
+    }
+    printf("%s: %s\n", name, errors == 0 ? "ok" : "wrong rounding");
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void spinner()
+{
+    run(FE_TOWARDZERO, "toward zero", 0);
+}
+
+void sleeper()
+{
+    run(FE_TOWARDZERO, "toward zero", 20000);
+}
+
+void upward()
+{
+    fesetround(FE_UPWARD);
+    run(FE_UPWARD, "upward", 20000);
+}
+
+void spawned()
+{
+    if (!rounds(FE_TOWARDZERO)) {
+        spawned_errors++;
+    }
+    spawned_finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test24:\n--------------\n");
+    fesetround(FE_TOWARDZERO);
+    toward_zero_third = two / three;
+    uthread_init(1000);
+
+    uthread_spawn(spinner);
+    uthread_spawn(sleeper);
+    uthread_attr attrs = {};
+    attrs.fp_env = 1;
+    uthread_spawn_ex(upward, &attrs);
+
+    int errors = 0;
+    int spawns = 0;
+    while (uthread_get_total_quantums() < QUANTUMS) {
+        if (!rounds(FE_TOWARDZERO)) {
+            errors++;
+        }
+        // the spawned thread runs for the first time once the timer preempts main
+        if (spawns < SPAWNED && uthread_get_total_quantums() > spawns * QUANTUMS / SPAWNED) {
+            uthread_spawn(spawned);
+            spawns++;
+        }
+    }
+    done = 1;
+    while (finished < 3 || spawned_finished < spawns) {
+        uthread_yield();
+    }
+    printf("spawned: %s\n", spawned_errors == 0 ? "ok" : "wrong rounding");
+    printf("main: %s\n", errors == 0 ? "ok" : "wrong rounding");
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * test25.cc - Spawns posted from a pthread while the threads allocate memory. The main thread spends its quanta in
+ * malloc and free, so the timer mostly preempts it in there, while a poster pthread spawns SPAWNED threads through
+ * the inbox, far more than the POOL threads reserved up front. The threads that start stay alive until all of them
+ * did, spinning, so that the pool runs dry and the thread table has to grow past MAX_THREAD_NUM. The spawns carried
+ * out at a preemption, or by a thread that just started, may only take threads of the pool: the others wait for the
+ * main thread's next library call. An allocation meanwhile would find the main thread preempted in the middle of
+ * malloc, with the heap locked.
+ *
+ * Output should be:
+ * test25:
+ * --------------
+ * started: 150
+ * allocations: ok
+ * main: ok
+ *
+ */
+
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define SPAWNED 150
+#define POOL 32
+#define IN_FLIGHT 200 // posts that wait in the inbox at most, below UTHREAD_INBOX_CAPACITY
+#define QUANTUMS 200
+#define BLOCKS 64
+
+std::atomic<int> posted(0);
+std::atomic<int> started(0);
+std::atomic<int> finished(0);
+volatile int release = 0;
+
+// Spins without library calls until released, so that no spawn is carried out outside the timer handler meanwhile
+void spawned()
+{
+    started++;
+    while (!release) {
+    }
+    finished++;
+    uthread_terminate(uthread_get_tid());
+}
+
+void* poster(void*)
+{
+    // the timer signal of the library must go to its own threads
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGVTALRM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    while (posted < SPAWNED) {
+        if (posted - started >= IN_FLIGHT) {
+            usleep(100);
+            continue;
+        }
+        if (uthread_post_spawn(spawned) == 0) {
+            posted++;
+        }
+    }
+    return nullptr;
+}
+
+int main()
+{
+    printf("test25:\n--------------\n");
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.max_threads = SPAWNED + 1;
+    options.pool_threads = POOL;
+    uthread_init_ex(&options);
+
+    pthread_t pthread;
+    pthread_create(&pthread, nullptr, poster, nullptr);
+
+    // the timer preempts the main thread in malloc and free most of the time
+    void* blocks[BLOCKS] = {};
+    int errors = 0;
+    unsigned int seed = 1;
+    while (uthread_get_total_quantums() < QUANTUMS) {
+        int i = rand_r(&seed) % BLOCKS;
+        free(blocks[i]);
+        size_t size = 16 + rand_r(&seed) % 4096;
+        blocks[i] = malloc(size);
+        if (blocks[i] == nullptr) {
+            errors++;
+            continue;
+        }
+        memset(blocks[i], i, size);
+    }
+    for (int i = 0; i < BLOCKS; i++) {
+        free(blocks[i]);
+    }
+
+    // the spawns the timer handler had to leave are carried out here
+    while (started < SPAWNED) {
+        uthread_yield();
+    }
+    pthread_join(pthread, nullptr);
+    release = 1;
+    while (finished < SPAWNED) {
+        uthread_yield();
+    }
+    printf("started: %d\n", started.load());
+    printf("allocations: %s\n", errors == 0 ? "ok" : "failed");
+    printf("main: ok\n");
+    uthread_terminate(0);
+    return 0;
+}
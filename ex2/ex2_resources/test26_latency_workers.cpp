@@ -0,0 +1,101 @@
+/*
+ * test26.cc - A latency-critical thread woken up by a thread on another worker. The latency-critical thread shares
+ * worker 1 with a spinner whose quantum is a second long, while the main thread, bound to worker 0, blocks and
+ * resumes it. Every time it is resumed it must preempt the spinner as soon as that ran min_quantum_usecs, and not wait
+ * for the end of the spinner's quantum.
+ *
+ * Output should be:
+ * test26:
+ * --------------
+ * latency-critical thread ran before the end of the spinner's quantum
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define WORKERS 2
+#define QUANTUM_USECS 1000000
+#define ROUNDS 5
+#define BLOCKED_NS 20000000LL // time the latency-critical thread stays blocked, so that the spinner runs meanwhile
+#define MAX_LATENCY_NS (QUANTUM_USECS * 1000LL / 4)
+
+volatile long long resumed_ns = 0;
+volatile long long latency_ns = -1;
+volatile bool critical_started = false;
+volatile bool spinner_started = false;
+
+long long now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void critical()
+{
+    critical_started = true;
+    for (;;) {
+        if (resumed_ns != 0) {
+            latency_ns = now_ns() - resumed_ns;
+            resumed_ns = 0;
+        }
+    }
+}
+
+void spinner()
+{
+    spinner_started = true;
+    for (;;) {
+    }
+}
+
+int main()
+{
+    printf("test26:\n--------------\n");
+    fflush(stdout);
+
+    uthread_options options = {};
+    options.quantum_usecs = QUANTUM_USECS;
+    options.timer_ticks = 500;
+    options.min_quantum_usecs = 1000;
+    options.workers = WORKERS;
+    if (uthread_init_ex(&options) != 0) {
+        return 1;
+    }
+    uthread_set_affinity(0, 1ULL << 0);
+
+    uthread_attr attrs = {};
+    attrs.latency_critical = 1;
+    int critical_tid = uthread_spawn_ex(critical, &attrs);
+    int spinner_tid = uthread_spawn(spinner);
+    uthread_set_affinity(critical_tid, 1ULL << 1);
+    uthread_set_affinity(spinner_tid, 1ULL << 1);
+    while (!critical_started || !spinner_started) {
+    }
+
+    long long worst_ns = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        uthread_block(critical_tid);
+        long long until = now_ns() + BLOCKED_NS;
+        while (now_ns() < until) {
+        }
+        latency_ns = -1;
+        resumed_ns = now_ns();
+        uthread_resume(critical_tid);
+        while (latency_ns < 0) {
+        }
+        if (latency_ns > worst_ns) {
+            worst_ns = latency_ns;
+        }
+    }
+    if (worst_ns < MAX_LATENCY_NS) {
+        printf("latency-critical thread ran before the end of the spinner's quantum\n");
+    } else {
+        printf("latency-critical thread waited %lld us\n", worst_ns / 1000);
+    }
+    fflush(stdout);
+    uthread_terminate(0);
+    return 0;
+}
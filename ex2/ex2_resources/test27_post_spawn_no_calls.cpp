@@ -0,0 +1,71 @@
+/*
+ * test27.cc - Spawns posted while no thread calls the library. The main thread starts a poster pthread and then only
+ * spins, with an empty pool (pool_threads is 0), and so do the threads the poster spawns until all of them started.
+ * No spawn can be carried out outside the timer handler, which may not allocate: they all have to run with the threads
+ * the first post added to the pool.
+ *
+ * Output should be:
+ * test27:
+ * --------------
+ * started: 8
+ * main: ok
+ *
+ */
+
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define SPAWNED 8 // at most UTHREAD_INBOX_POOL_THREADS
+#define TIMEOUT_SECS 5
+
+std::atomic<int> started(0);
+volatile int release = 0;
+
+// Spins without library calls until all the posted threads started
+void spawned()
+{
+    started++;
+    while (!release) {
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+void* poster(void*)
+{
+    // the timer signal of the library must go to its own threads
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGVTALRM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    for (int i = 0; i < SPAWNED; i++) {
+        uthread_post_spawn(spawned);
+    }
+    return nullptr;
+}
+
+int main()
+{
+    printf("test27:\n--------------\n");
+    fflush(stdout);
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    uthread_init_ex(&options);
+
+    pthread_t pthread;
+    pthread_create(&pthread, nullptr, poster, nullptr);
+
+    // no library call until the posted threads started, or the time is up
+    time_t end = time(nullptr) + TIMEOUT_SECS;
+    while (started < SPAWNED && time(nullptr) < end) {
+    }
+    release = 1;
+    pthread_join(pthread, nullptr);
+    printf("started: %d\n", started.load());
+    printf("main: ok\n");
+    uthread_terminate(0);
+    return 0;
+}
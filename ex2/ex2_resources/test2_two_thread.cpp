@@ -29,6 +29,23 @@
 #include <list>
 #include "uthreads.cpp"
 #include "Thread.cpp"
+#include "ThreadQueue.cpp"
+#include "TimerWheel.cpp"
+#include "IdAllocator.cpp"
+#include "Stack.cpp"
+#include "ThreadPool.cpp"
+#include "PreemptionTimer.cpp"
+#include "FeedbackQueue.cpp"
+#include "FeedbackPolicy.cpp"
+#include "RoundRobinPolicy.cpp"
+#include "FairPolicy.cpp"
+#include "DeadlinePolicy.cpp"
+#include "GroupPolicy.cpp"
+#include "PairingHeap.cpp"
+#include "MultiQueuePolicy.cpp"
+#include "SpinLock.cpp"
+#include "Inbox.cpp"
+#include "Numa.cpp"
 
 int quantumR = 1000;
 int currId = -1;
@@ -47,6 +64,8 @@ void f()
             rounds++;
             fflush(stdout);
 
+        } else {
+            uthread_yield(); // nothing to do until the other thread printed
         }
 
     }
@@ -0,0 +1,75 @@
+/*
+ * test3.cc - The scheduler must not allocate: switch 1M times between two threads and count the calls to operator new
+ * made meanwhile.
+ *
+ * Output should be:
+ * test3:
+ * --------------
+ * allocations during 1000000 switches: 0
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <new>
+#include "uthreads.h"
+
+#define SWITCHES 1000000
+
+static bool counting = false;
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (counting) {
+        allocations++;
+    }
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static int last_quantum;
+
+/* Gives up the rest of the quantum by raising the timer signal itself, which takes the same path as a real preemption */
+void switch_until_done()
+{
+    while (uthread_get_total_quantums() < last_quantum) {
+        raise(SIGVTALRM);
+    }
+}
+
+void f()
+{
+    switch_until_done();
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(int argc, char **argv)
+{
+    printf("test3:\n--------------\n");
+
+    // a quantum long enough that the real timer hardly ever fires - all switches come from raise()
+    uthread_init(999999);
+    if (uthread_spawn(f) == -1)
+        fprintf(stderr, "unjustified failrure to spawn\n");
+
+    last_quantum = uthread_get_total_quantums() + SWITCHES;
+    counting = true;
+    switch_until_done();
+    counting = false;
+
+    printf("allocations during %d switches: %ld\n", SWITCHES, allocations);
+    fflush(stdout);
+
+    uthread_terminate(0);
+    return 0;
+}
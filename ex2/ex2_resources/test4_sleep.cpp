@@ -0,0 +1,78 @@
+/*
+ * test4.cc - Sleeping threads: f sleeps 3 quantums, g sleeps 1 quantum but is also blocked by the main thread and only
+ * runs again once it is resumed. All quantums are ended by the threads raising SIGVTALRM themselves, so the output is
+ * deterministic.
+ *
+ * Output should be:
+ * test4:
+ * --------------
+ * m quantum 1
+ * f sleeps at quantum 2
+ * g sleeps at quantum 3
+ * m quantum 4
+ * m blocks g
+ * m quantum 5
+ * m quantum 6
+ * f wakes at quantum 7
+ * m quantum 8
+ * m quantum 9
+ * m resumes g
+ * g wakes at quantum 10
+ * m quantum 11
+ * m quantum 12
+ *
+ */
+
+#include <stdio.h>
+#include <signal.h>
+#include "uthreads.h"
+
+void f()
+{
+    printf("f sleeps at quantum %d\n", uthread_get_total_quantums());
+    uthread_sleep(3);
+    printf("f wakes at quantum %d\n", uthread_get_total_quantums());
+    uthread_terminate(uthread_get_tid());
+}
+
+void g()
+{
+    printf("g sleeps at quantum %d\n", uthread_get_total_quantums());
+    uthread_sleep(1);
+    printf("g wakes at quantum %d\n", uthread_get_total_quantums());
+    uthread_terminate(uthread_get_tid());
+}
+
+int main(int argc, char **argv)
+{
+    printf("test4:\n--------------\n");
+
+    // a quantum long enough that the real timer hardly ever fires - all switches come from raise(), one tick each
+    uthread_options options = {};
+    options.quantum_usecs = 999999;
+    options.timer_ticks = 1;
+    uthread_init_ex(&options);
+    uthread_spawn(f);
+    int g_tid = uthread_spawn(g);
+
+    while (uthread_get_total_quantums() < 12)
+    {
+        int quantum = uthread_get_total_quantums();
+        printf("m quantum %d\n", quantum);
+        if (quantum == 4)
+        {
+            printf("m blocks g\n");
+            uthread_block(g_tid);
+        }
+        if (quantum == 9)
+        {
+            printf("m resumes g\n");
+            uthread_resume(g_tid);
+        }
+        raise(SIGVTALRM);
+    }
+    printf("m quantum %d\n", uthread_get_total_quantums());
+
+    uthread_terminate(0);
+    return 0;
+}
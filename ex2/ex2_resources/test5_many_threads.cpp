@@ -0,0 +1,60 @@
+/*
+ * test5.cc - uthread_init_ex with a thread limit above MAX_THREAD_NUM: fill the table, then check that terminated ids
+ * are handed out again smallest first.
+ *
+ * Output should be:
+ * test5:
+ * --------------
+ * spawned 4999 threads, last id 4999
+ * thread library error: maximum number of threads exceeded
+ * spawn over the limit: -1
+ * respawned ids: 17 500 4999
+ *
+ */
+
+#include <stdio.h>
+#include "uthreads.h"
+
+#define MAX_THREADS 5000
+
+void f()
+{
+    while (1)
+    {
+    }
+}
+
+int main(int argc, char **argv)
+{
+    printf("test5:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 999999;
+    options.max_threads = MAX_THREADS;
+    uthread_init_ex(&options);
+
+    int spawned = 0;
+    int last = -1;
+    for (int i = 1; i < MAX_THREADS; i++)
+    {
+        int tid = uthread_spawn(f);
+        if (tid == -1)
+            break;
+        spawned++;
+        last = tid;
+    }
+    printf("spawned %d threads, last id %d\n", spawned, last);
+    fflush(stdout);
+    printf("spawn over the limit: %d\n", uthread_spawn(f));
+
+    uthread_terminate(4999);
+    uthread_terminate(500);
+    uthread_terminate(17);
+    int a = uthread_spawn(f);
+    int b = uthread_spawn(f);
+    int c = uthread_spawn(f);
+    printf("respawned ids: %d %d %d\n", a, b, c);
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * test6.cc - Preemption with every timer backend. Each backend runs in a child process, since the library can only be
+ * initialized once: a spinning thread and the spinning main thread must take turns until both got a few quantums.
+ * The last run drives a quantum with 4 timer ticks.
+ *
+ * Output should be:
+ * test6:
+ * --------------
+ * thread library error: unknown timer
+ * timer 0 (1 ticks): both threads preempted
+ * timer 1 (1 ticks): both threads preempted
+ * timer 2 (1 ticks): both threads preempted
+ * timer 2 (4 ticks): both threads preempted
+ *
+ */
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "uthreads.h"
+
+#define QUANTUMS 3
+
+void f()
+{
+    for (;;) {
+        for (volatile int i = 0; i < 1000; i++) {
+        }
+    }
+}
+
+void run(int timer, int ticks)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uthread_options options = {};
+        options.quantum_usecs = 10000;
+        options.timer = timer;
+        options.timer_ticks = ticks;
+        if (uthread_init_ex(&options) != 0) {
+            _exit(1);
+        }
+        int tid = uthread_spawn(f);
+        while (uthread_get_quantums(0) < QUANTUMS || uthread_get_quantums(tid) < QUANTUMS) {
+            for (volatile int i = 0; i < 1000; i++) {
+            }
+        }
+        printf("timer %d (%d ticks): both threads preempted\n", timer, ticks);
+        uthread_terminate(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    printf("test6:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 10000;
+    options.timer = 3;
+    uthread_init_ex(&options);
+
+    run(UTHREAD_TIMER_VIRTUAL, 1);
+    run(UTHREAD_TIMER_THREAD_CPU, 1);
+    run(UTHREAD_TIMER_MONOTONIC, 1);
+    run(UTHREAD_TIMER_MONOTONIC, 4);
+    return 0;
+}
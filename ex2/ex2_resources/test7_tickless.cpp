@@ -0,0 +1,63 @@
+/*
+ * test7.cc - Tickless mode: the main thread spinning alone never gets preempted, so the total number of quantums
+ * stays put. Once f is spawned the timer runs again, also while f sleeps and the main thread is the only one that can
+ * run, and stops again after f terminated.
+ *
+ * Output should be:
+ * test7:
+ * --------------
+ * main alone: 0 quantums passed
+ * f sleeps
+ * f wakes
+ * main alone again: 0 quantums passed
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.h"
+
+#define SPIN_SECONDS 0.1
+
+static volatile int done = 0;
+
+void spin()
+{
+    clock_t start = clock();
+    while (clock() - start < SPIN_SECONDS * CLOCKS_PER_SEC) {
+    }
+}
+
+void f()
+{
+    printf("f sleeps\n");
+    uthread_sleep(3);
+    printf("f wakes\n");
+    done = 1;
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test7:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 1000;
+    options.tickless = 1;
+    uthread_init_ex(&options);
+
+    int before = uthread_get_total_quantums();
+    spin();
+    printf("main alone: %d quantums passed\n", uthread_get_total_quantums() - before);
+
+    uthread_spawn(f);
+    while (!done) {
+    }
+
+    before = uthread_get_total_quantums();
+    spin();
+    printf("main alone again: %d quantums passed\n", uthread_get_total_quantums() - before);
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * test8.cc - Idle quantums. The main thread can't block or sleep through the library, so it is parked on the blocked
+ * list directly (hence the #include of the library sources). f sleeps 3 quantums with nothing else to run: the
+ * process waits them out in ppoll without using the CPU, they are counted like any other quantum, and f then resumes
+ * the main thread.
+ *
+ * Output should be:
+ * test8:
+ * --------------
+ * f sleeps at quantum 2
+ * f wakes at quantum 6
+ * main resumed at quantum 7
+ * idle CPU time under 10 ms
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "uthreads.cpp"
+#include "Thread.cpp"
+#include "ThreadQueue.cpp"
+#include "TimerWheel.cpp"
+#include "IdAllocator.cpp"
+#include "Stack.cpp"
+#include "ThreadPool.cpp"
+#include "PreemptionTimer.cpp"
+#include "FeedbackQueue.cpp"
+#include "FeedbackPolicy.cpp"
+#include "RoundRobinPolicy.cpp"
+#include "FairPolicy.cpp"
+#include "DeadlinePolicy.cpp"
+#include "GroupPolicy.cpp"
+#include "PairingHeap.cpp"
+#include "MultiQueuePolicy.cpp"
+#include "SpinLock.cpp"
+#include "Inbox.cpp"
+#include "Numa.cpp"
+
+void f()
+{
+    printf("f sleeps at quantum %d\n", uthread_get_total_quantums());
+    uthread_sleep(3);
+    printf("f wakes at quantum %d\n", uthread_get_total_quantums());
+    uthread_resume(0);
+    uthread_terminate(uthread_get_tid());
+}
+
+void block_main()
+{
+    enter_scheduler();
+    blocked_threads.push_back(threads[0]);
+    threads[0]->state = State::BLOCKED;
+    jump_to_next_thread(BLOCKED_JMP);
+    leave_scheduler();
+}
+
+int main()
+{
+    printf("test8:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 50000;
+    uthread_init_ex(&options);
+
+    uthread_spawn(f);
+    clock_t start = clock();
+    block_main();
+    clock_t used = clock() - start;
+    printf("main resumed at quantum %d\n", uthread_get_total_quantums());
+    printf("idle CPU time %s 10 ms\n", used < CLOCKS_PER_SEC / 100 ? "under" : "over");
+
+    uthread_terminate(0);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * test9.cc - Feedback queue scheduling with 3 levels. Every tick is raised by the running thread itself, so the output
+ * is deterministic. h and the main thread burn every tick they get and sink to the bottom level, where a quantum is 4
+ * ticks. i sleeps for a quantum every time it runs and stays at the top, so as soon as it wakes up it runs before the
+ * threads queued ahead of it. The boost at quantum 20 brings h and the main thread back to the top level.
+ *
+ * Output should be:
+ * test9:
+ * --------------
+ * m quantum 1
+ * h quantum 2
+ * i quantum 3
+ * m quantum 4
+ * m quantum 4
+ * i quantum 5
+ * h quantum 6
+ * h quantum 6
+ * i quantum 7
+ * m quantum 8
+ * m quantum 8
+ * m quantum 8
+ * m quantum 8
+ * i quantum 9
+ * h quantum 10
+ * h quantum 10
+ * h quantum 10
+ * h quantum 10
+ * m quantum 12
+ * m quantum 12
+ * m quantum 12
+ * m quantum 12
+ * h quantum 13
+ * h quantum 13
+ * h quantum 13
+ * h quantum 13
+ * m quantum 14
+ * m quantum 14
+ * m quantum 14
+ * m quantum 14
+ * h quantum 15
+ * h quantum 15
+ * h quantum 15
+ * h quantum 15
+ * m quantum 16
+ * m quantum 16
+ * m quantum 16
+ * m quantum 16
+ * h quantum 17
+ * h quantum 17
+ * h quantum 17
+ * h quantum 17
+ * m quantum 18
+ * m quantum 18
+ * m quantum 18
+ * m quantum 18
+ * h quantum 19
+ * h quantum 19
+ * h quantum 19
+ * h quantum 19
+ * m quantum 20
+ * h quantum 21
+ *
+ */
+
+#include <stdio.h>
+#include <signal.h>
+#include "uthreads.h"
+
+#define LAST_QUANTUM 22
+
+void tick(char name)
+{
+    printf("%c quantum %d\n", name, uthread_get_total_quantums());
+    raise(SIGVTALRM);
+}
+
+void h()
+{
+    for (;;) {
+        tick('h');
+    }
+}
+
+void i()
+{
+    for (int k = 0; k < 4; k++) {
+        printf("i quantum %d\n", uthread_get_total_quantums());
+        uthread_sleep(1);
+    }
+    uthread_terminate(uthread_get_tid());
+}
+
+int main()
+{
+    printf("test9:\n--------------\n");
+
+    uthread_options options = {};
+    options.quantum_usecs = 999999;
+    // every raise() is a whole quantum of the top level
+    options.timer_ticks = 1;
+    options.policy = UTHREAD_POLICY_MLFQ;
+    options.levels = 3;
+    options.boost_quantums = 20;
+    uthread_init_ex(&options);
+
+    uthread_spawn(h);
+    uthread_spawn(i);
+    while (uthread_get_total_quantums() < LAST_QUANTUM) {
+        tick('m');
+    }
+    uthread_terminate(0);
+    return 0;
+}
@@ -4,220 +4,1449 @@
 
 #include "Thread.h"
 #include "uthreads.h"
+#include "IdAllocator.h"
+#include "ThreadPool.h"
+#include "PreemptionTimer.h"
+#include "RoundRobinPolicy.h"
+#include "FeedbackPolicy.h"
+#include "FairPolicy.h"
+#include "DeadlinePolicy.h"
+#include "GroupPolicy.h"
+#include "MultiQueuePolicy.h"
+#include "SpinLock.h"
+#include "Worker.h"
+#include "Inbox.h"
+#include "Numa.h"
 #include <iostream>
-#include <list>
 #include <sys/time.h>
 #include <csignal>
-#include <csetjmp>
-#include <array>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <unistd.h>
+#include <poll.h>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
-#define RUNNING_JMP 1
 #define BLOCKED_JMP 2
 #define READY_JMP 3
 #define TERMINATED_JMP 4
+// preempted before the end of its quantum, or giving the rest of it up
+#define PREEMPTED_JMP 5
+// signalled by another worker that blocked or terminated the running thread, see kick_worker
+#define KICKED_JMP 6
 
-std::array<Thread*, MAX_THREAD_NUM> threads = {};
+// Timer ticks per quantum, unless uthread_init_ex is given another number. A switch doesn't restart the timer period,
+// so a thread switched to after a block or yield gets between DEFAULT_TIMER_TICKS - 1 and DEFAULT_TIMER_TICKS ticks
+// of quantum.
+#define DEFAULT_TIMER_TICKS 4
 
-std::list<Thread *> ready_threads;
-std::list<Thread *> blocked_threads;
+// Feedback queue levels and quantums between two priority boosts, unless uthread_init_ex is given others
+#define DEFAULT_LEVELS 8
+#define DEFAULT_BOOST_QUANTUMS 100
 
-static int current_thread_id = 0;
-static int quantum_duration = 0;
-static int total_quantums = 0;
+// In M:N mode, a thread that left the CPU less than this long ago is only stolen by an idle worker, see steal_threads
+#define DEFAULT_MIGRATION_COST_USECS 500
+
+// In adaptive mode, the quantum is long enough that a switch takes at most 1/SWITCH_COST_RATIO of it
+#define SWITCH_COST_RATIO 100
+
+// Stack for the SIGSEGV handler, which can't run on a thread stack that just overflowed
+#define SIGNAL_STACK_SIZE 65536
+// Stack of the idle loop of worker 0, see worker_idle
+#define IDLE_STACK_SIZE 65536
+
+// Indexed by thread id. Grows on spawn (inside the scheduler) up to the capacity of thread_ids. In M:N mode it has that
+// size from the start: a worker reads the slot of its running thread with its queue lock alone, see current_thread.
+std::vector<Thread*> threads;
+IdAllocator thread_ids;
+// Bumped whenever an id is given to a new thread, so that a request posted for the thread that had the id before is
+// told apart, see uthread_post_resume. Read by the posters without the scheduler lock, so the counters never move:
+// they come in blocks of GENERATION_BLOCK ids, allocated as the thread table grows over them (see grow_generations).
+// generation_blocks owns them, and id_generations holds the pointers the posters read, null for a block not reached.
+#define GENERATION_BLOCK 1024
+static std::vector<std::unique_ptr<std::atomic<unsigned int>[]>> generation_blocks;
+static std::unique_ptr<std::atomic<std::atomic<unsigned int>*>[]> id_generations;
+
+// The READY threads are held by the scheduling policy chosen by uthread_init_ex (see SchedulingPolicy.h)
+RoundRobinPolicy round_robin_policy;
+FeedbackPolicy feedback_policy;
+FairPolicy fair_policy;
+MultiQueuePolicy multi_queue_policy;
+SchedulingPolicy* policy = &round_robin_policy;
+// The policy chosen by uthread_init_ex, and the classes stacked on it once they are used, see stack_policies
+SchedulingPolicy* base_policy = &round_robin_policy;
+GroupPolicy group_policy;
+DeadlinePolicy deadline_policy;
+static bool groups_used = false;
+static bool deadlines_used = false;
+ThreadQueue blocked_threads;
+TimerWheel sleeping_threads;
+
+static int quantum_duration = 0; // quantum of the threads without one of their own, see uthread_set_default_quantum
+// Counted by every worker at every switch, without the scheduler lock in M:N mode, see count_quantum
+static std::atomic<int> total_quantums(0);
+// The last quantum the sleeping threads were woken up for, and a lower bound of the next one a sleep ends on, which
+// the workers check without the scheduler lock, see switch_needs_scheduler
+static int expired_quantums = 0;
+static std::atomic<int> next_wake_quantum(INT_MAX);
+
+// Kernel threads running the threads (uthread_options.workers), see Worker.h. Worker 0 is the kernel thread that called
+// uthread_init_ex. In M:N mode (more than one worker) the ready queue of each worker is guarded by the worker's queue
+// lock, and the rest of the scheduler state by scheduler_lock, see lock_scheduler.
+static Worker workers[UTHREAD_MAX_WORKERS];
+static int worker_count = 1;
+// The state of the calling kernel thread's worker that a thread reads or writes outside the scheduler, where it may be
+// preempted and resumed on another worker between any two instructions. These are thread-locals of the initial-exec
+// model rather than Worker fields: every access is then a single instruction relative to %fs, so a migration can't
+// split it, whereas a thread that read worker_index and then wrote through it may write to the worker it left.
+// volatile, so that they are read again on every use rather than kept across a switch.
+#define WORKER_LOCAL static thread_local __attribute__((tls_model("initial-exec")))
+// Index of the worker in workers
+WORKER_LOCAL volatile int worker_index = 0;
+// The thread on the worker's CPU, nullptr while the worker is idle. It may have terminated already: it still runs on
+// its stack until the worker switches away from it.
+WORKER_LOCAL Thread* volatile running_thread = nullptr;
+// Set while the worker is inside the scheduler (a library call, the timer handler, or idle). A timer signal that
+// arrives meanwhile must not touch the scheduler state, so it only sets preempt_pending, and the preemption is taken
+// by leave_scheduler. This replaces blocking SIGVTALRM with two sigprocmask calls around every library call.
+// A thread is always suspended inside the scheduler, so whoever resumes it finds in_scheduler set and clears it.
+WORKER_LOCAL volatile sig_atomic_t in_scheduler = 0;
+WORKER_LOCAL volatile sig_atomic_t preempt_pending = 0; // 0, or the state to jump_to_next_thread with
+// Workers that run a thread rather than idle, see worker_idle
+static int busy_workers = 1;
+// Idle workers asleep on their futex, and those woken up that didn't take the lock yet, see park_worker
+static int parked_workers = 0;
+static int waking_workers = 0;
+// The parked worker that wakes up every quantum to count it while no worker runs a thread, -1 if none
+static int timed_worker = -1;
+
+// Like the queue locks, it is held across a switch and released by the thread switched to
+static SpinLock scheduler_lock;
+// The worker whose thread called uthread_terminate(0) in M:N mode, -1 until then. Set before the other workers are
+// kicked, so that they take the scheduler lock rather than switch on their own queue, and stop once they have it, see
+// stop_worker.
+static volatile int exiting_worker = -1;
+
+// Control blocks and stacks of terminated threads, reused by spawn
+ThreadPool thread_pool;
+
+// Resumes and spawns posted by threads outside the scheduler, see uthread_post_resume and drain_inbox. Posting is
+// refused until uthread_init_ex is done.
+Inbox inbox;
+static std::atomic<bool> inbox_open(false);
+// The threads the first uthread_post_spawn created for the pool, linked through next, until drain_inbox moves them in
+static std::atomic<bool> inbox_reserved(false);
+static std::atomic<Thread*> reserved_threads(nullptr);
+
+// A terminated thread whose stack is still in use - it terminated itself, or another worker terminated it while it
+// ran - waits here with its id until its worker switched away from it, and is returned to the pool later by the
+// reaper, running on another thread's stack
+ThreadQueue terminated_threads;
 
-struct itimerval timer;
 struct sigaction sa;
 
-sigset_t ms;
+// The clock of the workers' timers, and the timer ticks per quantum
+static int timer_kind = UTHREAD_TIMER_VIRTUAL;
+// UTHREAD_POLICY_FAIR on a CPU-time timer: threads are charged CPU time, see cpu_clock_ns
+static bool cpu_charging = false;
+static int quantum_ticks = 1;
+static sigset_t timer_signal;
+// The signal mask while idle: the process' own, plus SIGVTALRM
+static sigset_t idle_mask;
+
+// Adaptive quantum (uthread_options.adaptive_quantum): the quantum is sized at every switch, by every worker for the
+// threads of its own queue, see adapt_quantum
+static bool adaptive = false;
+static long long min_quantum_ns = 0;
+static long long max_quantum_ns = 0;
+static long long target_latency_ns = 0;
+
+// The message of an invalid thread id, which has the id range in it
+static char out_of_bounds_error[80];
+
+// Tickless mode (uthread_options.tickless): the timer only runs while a thread waits for the CPU or a sleeping thread
+// needs the quantums counted, see update_tick
+static bool tickless = false;
 
 void jump_to_next_thread(int state);
+void leave_scheduler(bool in_handler = false, bool may_allocate = true);
+void update_policy_event();
+void update_tick();
+void wake_idle_workers();
+void drain_inbox(bool may_allocate = true);
+void finish_switch();
+void switch_to_idle();
+long long clock_ns();
+
+Worker& me(){
+    return workers[worker_index];
+}
+
+// The thread running on the calling worker, nullptr if it terminated: it still runs until the worker switches away
+// from it, but its id is no longer in the table. In M:N mode the slot is cleared under the thread's queue lock, see
+// delete_single_thread.
+Thread* current_thread(){
+    Thread* running = running_thread;
+    return running != nullptr && threads[running->thread_id] == running ? running : nullptr;
+}
+
+// The locks of M:N mode. A worker inside the scheduler always holds the lock of its own ready queue: that is all a
+// switch needs when the running thread just goes back to that queue and nothing else waits to be done (see
+// switch_needs_scheduler), so the workers switch and steal from each other without a lock they all share. Anything
+// else - a library call, a thread that blocks or sleeps, the inbox, the idle loop - takes scheduler_lock too, always
+// before the queue lock, and only with both may it take the queue lock of another worker, one at a time (see
+// lock_queue). A worker holding its queue lock alone never waits for another lock: it only tries those of the workers
+// it steals from, see steal_threads. Both locks are released by leave_scheduler, on whichever thread leaves the
+// scheduler on the worker.
+
+// Takes scheduler_lock and the calling worker's queue lock, whichever it doesn't hold yet. A worker holding only its
+// queue lock lets go of it first, so the caller must not be in the middle of a change to its queue.
+void lock_scheduler(){
+    if(worker_count == 1){
+        return;
+    }
+    Worker& worker = me();
+    if(worker.holds_scheduler_lock){
+        return;
+    }
+    if(worker.holds_queue_lock){
+        worker.queue_lock.unlock();
+    }
+    scheduler_lock.lock();
+    worker.queue_lock.lock();
+    worker.holds_scheduler_lock = true;
+    worker.holds_queue_lock = true;
+    if(exiting_worker >= 0 && worker.index != exiting_worker && running_thread != nullptr){
+        // the process exits: the thread is left as it is, and the worker stops in its idle loop
+        switch_to_idle();
+    }
+}
+
+// Takes the calling worker's queue lock, if it doesn't hold it yet
+void lock_own_queue(){
+    if(worker_count == 1){
+        return;
+    }
+    Worker& worker = me();
+    if(!worker.holds_queue_lock){
+        worker.queue_lock.lock();
+        worker.holds_queue_lock = true;
+    }
+}
+
+// Releases the locks the calling worker holds
+void unlock_scheduler(){
+    if(worker_count == 1){
+        return;
+    }
+    Worker& worker = me();
+    if(worker.holds_queue_lock){
+        worker.holds_queue_lock = false;
+        worker.queue_lock.unlock();
+    }
+    if(worker.holds_scheduler_lock){
+        worker.holds_scheduler_lock = false;
+        scheduler_lock.unlock();
+    }
+}
+
+// Whether the calling worker may touch the state shared by the workers: always in 1:N mode
+bool holds_scheduler_lock(){
+    return worker_count == 1 || me().holds_scheduler_lock;
+}
+
+// Takes the queue lock of a worker, which the caller holds already if it is its own. Must be called with
+// scheduler_lock.
+void lock_queue(int worker){
+    if(worker_count > 1 && worker >= 0 && worker != worker_index){
+        workers[worker].queue_lock.lock();
+    }
+}
 
+void unlock_queue(int worker){
+    if(worker_count > 1 && worker >= 0 && worker != worker_index){
+        workers[worker].queue_lock.unlock();
+    }
+}
+
+// Takes the queue lock of the worker the thread is queued on or runs on (Thread::worker), which a thief may change
+// until then, and returns that worker for unlock_queue; -1 for a thread that never was on a worker. Must be called
+// with scheduler_lock.
+int lock_thread_queue(const Thread* thread){
+    for(;;){
+        int worker = thread->worker;
+        lock_queue(worker);
+        if(thread->worker == worker){
+            return worker;
+        }
+        unlock_queue(worker);
+    }
+}
+
+void enter_scheduler(){
+    in_scheduler = 1;
+    // keep the compiler from moving scheduler memory accesses above the flag
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    lock_scheduler();
+    if(worker_count > 1 && current_thread() == nullptr){
+        // another worker terminated the calling thread while it waited for the lock, see kick_worker
+        jump_to_next_thread(TERMINATED_JMP);
+    }
+}
+
+// For a call that only gives the CPU up (uthread_yield): jump_to_next_thread takes the locks the switch needs
+void enter_scheduler_to_switch(){
+    in_scheduler = 1;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+// The timer handler passes in_handler: SIGVTALRM is then blocked again before the flag is cleared, and the handler's
+// return restores the mask. A tick between clearing the flag and that return would nest another handler on the
+// thread's stack, and at a fast tick rate those could pile up until the stack overflows.
+// Without may_allocate the posted requests that need memory are left for later, see drain_inbox.
+void leave_scheduler(bool in_handler, bool may_allocate){
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    for(;;){
+        // the flag is the one of the worker the thread runs on, after a jump too
+        while(preempt_pending){
+            int state = preempt_pending;
+            preempt_pending = 0;
+            jump_to_next_thread(state);
+        }
+        lock_own_queue();
+        if(!holds_scheduler_lock() && inbox.pending()){
+            // switched to on the worker's queue alone, the requests need the scheduler lock
+            lock_scheduler();
+            continue;
+        }
+        bool shared = holds_scheduler_lock();
+        if(shared){
+            drain_inbox(may_allocate);
+        }
+        update_policy_event();
+        if(preempt_pending){
+            continue;
+        }
+        update_tick();
+        if(shared){
+            // a switch on the worker's queue alone leaves no new work to the others
+            wake_idle_workers();
+        }
+        if(in_handler){
+            sigprocmask(SIG_BLOCK, &timer_signal, nullptr);
+            if(preempt_pending){
+                // noted before the signal was blocked, the thread switched to must run with it unblocked
+                sigprocmask(SIG_UNBLOCK, &timer_signal, nullptr);
+                continue;
+            }
+        }
+        unlock_scheduler();
+        in_scheduler = 0;
+        if(!preempt_pending){
+            return;
+        }
+        // a tick came in between the check and the clear and was only noted, take it now
+        in_scheduler = 1;
+    }
+}
+
+// Notes a preemption for leave_scheduler to take. The end of the quantum wins over an early preemption, and both
+// over a kick.
+void note_preemption(int state){
+    if(preempt_pending == READY_JMP || (state == KICKED_JMP && preempt_pending != 0)){
+        return;
+    }
+    preempt_pending = state;
+}
+
+// The kernel blocks SIGVTALRM while the handler runs, so ticks that come in faster than the handler can set
+// in_scheduler don't pile signal frames up on the thread's stack. Once the flag is set the signal is unblocked again:
+// the thread switched to may not return through this handler, and library calls rely on the flag alone, so the mask
+// only changes in the preemption path (see leave_scheduler for the way out).
+// A tick before the end of the quantum only preempts once the policy's event is due. A kick from another worker
+// doesn't use up a tick.
+// The kernel enters the handler with the default floating-point control state, and restores the preempted thread's
+// own on the way out. Threads switched to from here that were suspended elsewhere resume with the state as it is
+// here, so it is set to the one threads without fp_env share (see uthread_spawn_ex) before the switch.
 void timer_handler(int sig){
+    Worker& worker = me();
+    int state = READY_JMP;
+    if(worker.kicked){
+        worker.kicked = 0;
+        state = KICKED_JMP;
+    } else {
+        worker.budget_ticks = worker.budget_ticks - 1;
+        if(worker.budget_ticks > 0){
+            if(worker.policy_event_ns == LLONG_MAX || clock_ns() < worker.policy_event_ns){
+                return;
+            }
+            state = PREEMPTED_JMP;
+        }
+    }
+    if(in_scheduler){
+        note_preemption(state);
+        return;
+    }
+    // the flag is set before the signal is unblocked, jump_to_next_thread may wait for a lock and never return
+    enter_scheduler_to_switch();
+    sigprocmask(SIG_UNBLOCK, &timer_signal, nullptr);
+    load_fp_control(&initial_fp_control);
+    jump_to_next_thread(state);
+    leave_scheduler(true, false);
+}
+
+// First function a spawned thread runs, on its own stack (see thread_bootstrap in Thread.cpp).
+// The thread was switched to from inside the scheduler and does not return through that path, so it leaves the
+// scheduler here before running the user's code - as if from the timer handler, since that may be where the switch
+// came from.
+extern "C" void thread_main(Thread* self){
+    finish_switch();
+    leave_scheduler(false, false);
+    self->entry_point_func();
+    // a thread that returns from its entry point is terminated as if it called uthread_terminate on itself
+    uthread_terminate(self->thread_id);
+}
+
+// Runs on the worker's signal_stack. A fault in the guard page of the running thread's stack is reported as a stack
+// overflow; in any case the handler then restores the default action and returns, so the faulting access kills the
+// process as it would have without us.
+void segv_handler(int sig, siginfo_t* info, void* ucontext){
+    Thread* current = running_thread;
+    if(current != nullptr && current->stack.is_guard(info->si_addr)){
+        char message[128];
+        int length = snprintf(message, sizeof(message), "thread library error: stack overflow in thread %d "
+                              "(stack size %zu bytes)\n", current->thread_id, current->stack.size());
+        if(write(STDERR_FILENO, message, length) < 0){
+            // nothing left to report to
+        }
+    }
+    signal(SIGSEGV, SIG_DFL);
+}
 
-    jump_to_next_thread(READY_JMP);
+// The alternate signal stack belongs to the kernel thread, every worker sets its own up
+int install_signal_stack(){
+    Stack& signal_stack = me().signal_stack;
+    if(!signal_stack.allocate(SIGNAL_STACK_SIZE, me().node)){
+        printf("system error: failed to allocate the signal stack\n");
+        return -1;
+    }
+    stack_t ss = {};
+    ss.ss_sp = signal_stack.top() - signal_stack.size();
+    ss.ss_size = signal_stack.size();
+    if(sigaltstack(&ss, nullptr) == -1){
+        printf("system error: sigaltstack failed\n");
+        return -1;
+    }
+    return 0;
 }
 
-//int timer_handler(){
-//    sigsetjmp(threads[current_thread_id]->env, 1);
-//    ready_threads.push_back(threads[current_thread_id]);
-//    jump_to_next_thread(READY_JMP);
-//    return 0;
-//}
+// Pins the calling kernel thread to the CPU of its worker, if it has one (uthread_options.pin_workers), and finds the
+// NUMA node of that CPU. Must run before the worker allocates memory of its own.
+int pin_worker(){
+    Worker& worker = me();
+    if(worker.cpu < 0){
+        return 0;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(worker.cpu, &set);
+    if(sched_setaffinity(0, sizeof(set), &set) < 0){
+        printf("system error: sched_setaffinity failed\n");
+        return -1;
+    }
+    // the kernel moved the calling thread to the CPU before returning
+    worker.node = numa_current_node();
+    return 0;
+}
+
+int install_overflow_handler(){
+    if(install_signal_stack() < 0){
+        return -1;
+    }
+    struct sigaction segv = {};
+    segv.sa_sigaction = &segv_handler;
+    segv.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    if(sigaction(SIGSEGV, &segv, nullptr) < 0){
+        printf("sigaction error.");
+        return -1;
+    }
+    return 0;
+}
 
-int initiate_timer(int quantum_usecs){
+// Sizes the next quantum in adaptive mode: the target latency shared among the runnable threads (the ready ones and
+// the one about to run), so that each of them runs again within it, but at least SWITCH_COST_RATIO switches long, and
+// within the configured bounds. It only changes when it moved by more than an eighth, so that a thread count going
+// up and down by one doesn't reprogram the timer on every switch.
+void adapt_quantum(){
+    Worker& worker = me();
+    long long quantum = target_latency_ns / (policy->size() + 1);
+    if(quantum < worker.switch_cost_ns * SWITCH_COST_RATIO){
+        quantum = worker.switch_cost_ns * SWITCH_COST_RATIO;
+    }
+    if(quantum < min_quantum_ns){
+        quantum = min_quantum_ns;
+    }
+    if(quantum > max_quantum_ns){
+        quantum = max_quantum_ns;
+    }
+    int usecs = (int) (quantum / 1000);
+    if(usecs * 8LL < worker.adaptive_usecs * 7LL || usecs * 8LL > worker.adaptive_usecs * 9LL){
+        worker.adaptive_usecs = usecs;
+    }
+}
 
-    if(sigemptyset(&ms) == -1){
-        printf("system error: failed to empty set\n.");
+// Sets the timer period for the quantum of the thread about to run: its own (uthread_set_quantum), or the default one.
+// The ticks are not made finer to fit every quantum - a timer signal costs more than a switch - the period is changed
+// instead, which costs a syscall only when two threads with different quantums follow each other. A new period
+// starts whole, for the thread switched to.
+void set_quantum_timer(const Thread* thread){
+    Worker& worker = me();
+    int quantum = thread->quantum_usecs > 0 ? thread->quantum_usecs : adaptive ? worker.adaptive_usecs :
+                  quantum_duration;
+    int period = quantum / quantum_ticks;
+    if(period < 1){
+        period = 1;
     }
-    if(sigaddset(&ms,SIGVTALRM) == -1){
-        printf("system error: failed to add signal to mask\n.");
+    if(period != worker.tick_usecs){
+        worker.tick_usecs = period;
+        worker.timer.set_period(period);
     }
+}
 
-    timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = quantum_usecs;
+// Timer ticks in the thread's next quantum, which the policy may make longer than the base quantum
+int quantum_budget(const Thread* thread){
+    long ticks = (long) quantum_ticks * policy->time_slice(thread);
+    return ticks > INT_MAX ? INT_MAX : (int) ticks;
+}
 
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = 0;
+// Whether the worker's handoff thread can run next: the policy lets it go first, and it may run on the worker
+bool can_pick_handoff(const Worker& worker){
+    return worker.handoff != nullptr && (worker.handoff->affinity >> worker.index & 1) != 0 &&
+           policy->can_pick(worker.handoff);
+}
 
-    // Start a virtual timer. It counts down whenever this process is executing.
-    if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
-    {
-//        printf("system error: timer failed to start\n.");
+// When the running thread gives the CPU up to the latency-critical thread that woke up: once it ran min_quantum_ns of
+// its quantum, so that a thread waking up all the time can't starve it. Latency-critical and deadline threads are
+// not preempted for it. LLONG_MAX for never, 0 for right away. Forgets a handoff thread that can't run next anymore.
+long long wakeup_preemption_ns(const Thread* current){
+    Worker& worker = me();
+    if(!can_pick_handoff(worker)){
+        worker.handoff = nullptr;
+        return LLONG_MAX;
     }
-    return EXIT_SUCCESS;
+    if(current == nullptr || current->latency_critical || current->dl_period_ns > 0){
+        return LLONG_MAX;
+    }
+    long long due = worker.quantum_start_ns + min_quantum_ns;
+    return due <= clock_ns() ? 0 : due;
 }
 
-int first_available_id(){
-    for(int i = 0 ; i < MAX_THREAD_NUM; i ++){
-        if(threads[i] == nullptr){
-            return i;
+// Asks the policy when the running thread must give the CPU up next, and notes a preemption right away if it must
+// now. Called inside the scheduler on every way out of it (see leave_scheduler), after any change to the READY threads.
+void update_policy_event(){
+    Worker& worker = me();
+    Thread* current = current_thread();
+    long long event = policy->next_event_ns(current, worker.run_start_ns);
+    if(worker.handoff != nullptr){
+        long long wakeup = wakeup_preemption_ns(current);
+        if(wakeup < event){
+            event = wakeup;
         }
     }
-    return -1;
+    if(event == 0){
+        worker.policy_event_ns = LLONG_MAX;
+        preempt_pending = PREEMPTED_JMP;
+    } else {
+        worker.policy_event_ns = event;
+    }
 }
 
-void block_mask_sig(){
-    if(sigprocmask(SIG_BLOCK,&ms, nullptr) == -1){
-        printf("system error: failed to block signal\n.");
+// In tickless mode, arms the timer if a thread is waiting for the CPU or sleeping, and disarms it otherwise. Called
+// inside the scheduler on every way out of it (see leave_scheduler), so it sees every change to the ready queue and
+// the sleeping threads; it only makes a syscall when the answer changes.
+void update_tick(){
+    if(!tickless){
+        return;
+    }
+    Worker& worker = me();
+    bool needed = !policy->empty() || !sleeping_threads.empty() || worker.policy_event_ns != LLONG_MAX;
+    if(needed && !worker.timer.armed()){
+        // the running thread had the CPU to itself until now, its quantum starts here
+        worker.budget_ticks = quantum_budget(current_thread());
+        worker.timer.arm();
+    } else if(!needed && worker.timer.armed()){
+        worker.timer.disarm();
     }
 }
 
-void unblock_mask_sig(){
-    if(sigprocmask(SIG_UNBLOCK,&ms, nullptr) == -1){
-        printf("system error: failed to unblock signal\n.");
+long long clock_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// The clock the policy charges threads on under UTHREAD_POLICY_FAIR with a CPU-time timer (see cpu_charging): the
+// one the timer counts quantums on, so that a thread isn't charged for the time its worker was descheduled by the
+// kernel while the quantum doesn't run out either. It is the CPU time of the calling worker's kernel thread, the part
+// of the process's CPU time that worker's threads used. There is no vDSO for it, so the other policies keep charging
+// wall-clock time rather than make every switch a system call.
+long long cpu_clock_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Adds the time since the running thread was switched to (or last charged) to its run time, and tells the policy.
+// current is nullptr when the running thread just terminated, or the worker is idle. Must be called inside the
+// scheduler.
+void charge_running_thread(Thread* current){
+    Worker& worker = me();
+    long long now = clock_ns();
+    long long cpu_now = cpu_charging ? cpu_clock_ns() : 0;
+    if(current != nullptr){
+        current->run_time_ns += now - worker.run_start_ns;
+        policy->charge(current, cpu_charging ? cpu_now - worker.cpu_start_ns : now - worker.run_start_ns);
     }
+    worker.run_start_ns = now;
+    worker.cpu_start_ns = cpu_now;
 }
 
-//Reached here because quantum expired
-//We move running thread to ready and first ready to running
-//int timer_handler(){
-//    sigsetjmp(threads[current_thread_id]->env, 1);
-//    ready_threads.push_back(threads[current_thread_id]);
-//    jump_to_next_thread(READY_JMP);
-//    return 0;
-//}
+// Puts the scheduling classes in use on top of each other: deadline threads before the groups, and the groups before
+// the policy chosen by uthread_init_ex, which holds group 0. A class is only stacked once it is used, so a program that
+// doesn't use it doesn't pay for it. The classes hand the threads they don't hold down to their base, so the threads
+// already queued stay where they are. Must be called inside the scheduler.
+void stack_policies(){
+    SchedulingPolicy* top = base_policy;
+    if(groups_used){
+        group_policy.init(top, quantum_duration * 1000LL);
+        top = &group_policy;
+    }
+    if(deadlines_used){
+        deadline_policy.init(top);
+        top = &deadline_policy;
+    }
+    policy = top;
+}
+
+// Takes the smallest free id and makes sure the table has a slot for it. Must be called inside the scheduler.
+// Allocates the generation counters of the ids the thread table has slots for. Called as the table grows.
+void grow_generations(){
+    while(generation_blocks.size() * GENERATION_BLOCK < threads.size()){
+        std::atomic<unsigned int>* block = new std::atomic<unsigned int>[GENERATION_BLOCK]();
+        generation_blocks.emplace_back(block);
+        id_generations[generation_blocks.size() - 1].store(block, std::memory_order_release);
+    }
+}
+
+// The generation of tid, 0 while no thread had it. Lock-free, for the posters.
+unsigned int id_generation(int tid){
+    std::atomic<unsigned int>* block = id_generations[tid / GENERATION_BLOCK].load(std::memory_order_acquire);
+    return block == nullptr ? 0 : block[tid % GENERATION_BLOCK].load(std::memory_order_relaxed);
+}
+
+// Must be called inside the scheduler, for an id the thread table has a slot for
+void bump_generation(int tid){
+    generation_blocks[tid / GENERATION_BLOCK][tid % GENERATION_BLOCK].fetch_add(1, std::memory_order_relaxed);
+}
+
+int first_available_id(){
+    int tid = thread_ids.allocate();
+    if(tid >= (int) threads.size()){
+        // ids are handed out smallest first, so tid is at most threads.size()
+        size_t size = threads.size() * 2;
+        if(size > (size_t) thread_ids.capacity()){
+            size = thread_ids.capacity();
+        }
+        threads.resize(size, nullptr);
+        grow_generations();
+    }
+    return tid;
+}
+
+// Reports a library error found inside the scheduler. In M:N mode it goes straight to the file descriptor: stdio locks
+// belong to kernel threads, and the thread holding the stdout one may be suspended on another worker, waiting for the
+// scheduler lock held here.
+void report_error(const char* message){
+    if(worker_count > 1){
+        if(write(STDOUT_FILENO, message, strlen(message)) < 0){
+            // nothing left to report to
+        }
+    } else {
+        fputs(message, stdout);
+    }
+}
 
 int handle_valid_thread_id(int tid){
-    if(tid < 0 || tid >= MAX_THREAD_NUM){
-        printf("thread library error: out of bounds thread id [0-99 only]\n",stderr);
+    if(tid < 0 || tid >= (int) threads.size()){
+        report_error(out_of_bounds_error);
         return -1;
     }
     if(threads[tid] == nullptr){
-        printf("thread library error: thread id is null\n",stderr);
+        report_error("thread library error: thread id is null\n");
         return -1;
     }
     return 0;
 }
 
-void delete_single_thread(int tid){
-    block_mask_sig();
+// Returns the terminated threads that no worker runs on anymore to the pool, and their ids to thread_ids. Must be
+// called inside the scheduler. jump_to_next_thread calls it, and spawn, so that a thread that just exited can be
+// reused right away.
+void reap_terminated_threads(){
+    Thread* thread = terminated_threads.front();
+    while(thread != nullptr){
+        Thread* next = thread->next;
+        if(!thread->on_cpu){
+            terminated_threads.remove(thread);
+            thread_ids.release(thread->thread_id);
+            thread_pool.release(thread);
+        }
+        thread = next;
+    }
+}
 
-    // todo : added this if
-//    if (threads[tid]->state == RUNNING){
-//        delete threads[tid]
-//    }
+// Takes the smallest free id and a thread from the pool for a spawn, ready to start at entry_point, with its memory on
+// the NUMA node of the calling worker, which the thread is queued on. Must be called inside the scheduler. Returns
+// nullptr, once the error is reported, if the maximum number of threads is reached.
+Thread* create_thread(thread_entry_point entry_point, int stack_size){
+    reap_terminated_threads();
+    int tid = first_available_id();
+    if(tid==-1){
+        report_error("thread library error: maximum number of threads exceeded\n");
+        return nullptr;
+    }
+    threads[tid] = thread_pool.acquire(tid,entry_point,stack_size,me().node);
+    if(threads[tid] == nullptr){
+        report_error("system error: memory allocation failed\n");
+        exit(1);
+    }
+    bump_generation(tid);
+    return threads[tid];
+}
 
+// Like create_thread, for a spawn carried out in the timer handler, where malloc and mmap may not run: the thread it
+// preempted may be in the middle of either. Only a thread of the pool whose stack fits is taken (see
+// uthread_options.pool_threads), with an id the table has a slot for already. Returns nullptr, without reporting
+// anything, if that can't be done.
+Thread* create_pooled_thread(thread_entry_point entry_point){
+    reap_terminated_threads();
+    int tid = thread_ids.allocate();
+    if(tid == -1){
+        return nullptr;
+    }
+    Thread* thread = tid < (int) threads.size() ? thread_pool.acquire_free(tid, entry_point, STACK_SIZE, me().node)
+                                                 : nullptr;
+    if(thread == nullptr){
+        thread_ids.release(tid);
+        return nullptr;
+    }
+    threads[tid] = thread;
+    bump_generation(tid);
+    return thread;
+}
 
-    ready_threads.remove(threads[tid]);
-    blocked_threads.remove(threads[tid]);
-    delete threads[tid];
-    threads[tid] = nullptr;
+// Sends the worker's timer handler a kick, see timer_handler
+void signal_worker(Worker& worker){
+    worker.kicked = 1;
+    pthread_kill(worker.pthread, SIGVTALRM);
+}
 
-    unblock_mask_sig();
+// Makes the worker that runs the thread, blocked or terminated by another worker, notice it: the worker's timer
+// handler takes the thread off the CPU. Must be called inside the scheduler, with the thread's queue lock.
+void kick_worker(const Thread* thread){
+    if(!thread->on_cpu || thread->worker == worker_index){
+        return;
+    }
+    signal_worker(workers[thread->worker]);
+}
+
+// Must be called inside the scheduler
+void delete_single_thread(int tid){
+    Thread* thread = threads[tid];
+    if(thread == nullptr){
+        return;
+    }
+    // the worker that runs the thread finds its slot empty at its next switch, see current_thread
+    int worker = lock_thread_queue(thread);
+    policy->remove(thread);
+    threads[tid] = nullptr;
+    bool on_cpu = thread->on_cpu;
+    kick_worker(thread);
+    unlock_queue(worker);
+    blocked_threads.remove(thread);
+    sleeping_threads.remove(thread);
+    if(thread->dl_period_ns > 0){
+        deadline_policy.set_params(thread, 0, 0, 0); // gives its share of the CPU back
+    }
+    for(int i = 0; i < worker_count; i++){
+        lock_queue(i);
+        if(workers[i].handoff == thread){
+            workers[i].handoff = nullptr;
+        }
+        unlock_queue(i);
+    }
+    if(tid == 0){
+        thread_ids.release(tid);
+        delete thread; // the main thread has no stack of its own and is never reused
+    } else if(on_cpu){
+        terminated_threads.push_back(thread);
+    } else {
+        thread_ids.release(tid);
+        thread_pool.release(thread);
+    }
 }
 
 int terminate_all_threads(){
-    for(int i = 0 ; i < MAX_THREAD_NUM ; i ++){
+    for(int i = 0 ; i < (int) threads.size() ; i ++){
         delete_single_thread(i);
     }
     return EXIT_SUCCESS;
 }
 
 bool is_thread_blocked(int tid) {
-    bool thread_in_blocked = false;
-    for(auto t : blocked_threads){
-        if(t->thread_id == tid){
-            thread_in_blocked = true;
-            break;
+    return blocked_threads.contains(threads[tid]);
+}
+
+// Queues a READY thread that no worker runs on the worker the policy puts it on, under that worker's queue lock. Must
+// be called inside the scheduler.
+void enqueue_thread(Thread* thread){
+    if(worker_count == 1){
+        policy->enqueue(thread);
+        return;
+    }
+    int worker = multi_queue_policy.queue_of(thread);
+    lock_queue(worker);
+    thread->worker = worker;
+    policy->enqueue(thread);
+    unlock_queue(worker);
+}
+
+// Queues the calling worker's running thread, READY again as it leaves the CPU. In M:N mode one that may no longer run
+// on the worker, or any one while threads are scattered (see MultiQueuePolicy), waits for the end of the switch (see
+// Worker::moving): the worker it goes to could pick it up and wait for its context to be saved, while this one may
+// still wait for that worker's lock. Must be called inside the scheduler.
+void requeue_running_thread(Thread* thread){
+    if(worker_count > 1 && ((thread->affinity >> worker_index & 1) == 0 || multi_queue_policy.scatters())){
+        me().moving = thread;
+        return;
+    }
+    policy->enqueue(thread);
+}
+
+// Makes the latency-critical thread that just woke up the handoff thread of the worker it was queued on, unless that
+// worker has one already. Another worker that runs a thread is kicked, so that its timer handler sees the handoff on
+// the way out (see update_policy_event) rather than at its next switch; an idle one finds it in its idle loop.
+// Must be called inside the scheduler.
+void hand_off_to(Thread* thread){
+    if(worker_count == 1){
+        if(me().handoff == nullptr){
+            me().handoff = thread;
         }
+        return;
+    }
+    int index = lock_thread_queue(thread);
+    Worker& worker = workers[index];
+    if(worker.handoff == nullptr){
+        worker.handoff = thread;
+        if(index != worker_index && worker.busy){
+            signal_worker(worker);
+        }
+    }
+    unlock_queue(index);
+}
+
+// A blocked or sleeping thread becomes READY. Must be called inside the scheduler.
+// A thread another worker still runs - blocked from here before that worker took it off the CPU - just keeps running.
+void wake_thread(Thread* thread) {
+    int worker = lock_thread_queue(thread);
+    bool running_elsewhere = thread->on_cpu && thread != running_thread;
+    if(running_elsewhere){
+        thread->state = State::RUNNING;
+    }
+    unlock_queue(worker);
+    if(running_elsewhere){
+        return;
+    }
+    thread->state = State::READY;
+    policy->on_wake(thread);
+    if(thread == running_thread){
+        requeue_running_thread(thread);
+    } else {
+        enqueue_thread(thread);
+    }
+    if(thread->latency_critical){
+        hand_off_to(thread);
+    }
+}
+
+// Called by the timer wheel for a thread whose sleep is over
+void wake_sleeping_thread(Thread* thread) {
+    thread->wake_quantum = 0;
+    // a thread that was also blocked stays BLOCKED until it is resumed
+    if(!blocked_threads.contains(thread)){
+        wake_thread(thread);
+    }
+}
+
+// Wakes the threads whose sleep ends with the quantums counted since it last ran: the current one in 1:N mode, where
+// it runs at every switch, possibly several in M:N mode, where the workers count quantums on switches it doesn't run
+// on (see switch_needs_scheduler). Only those threads are touched.
+int wake_sleeping_threads() {
+    int now = total_quantums.load(std::memory_order_relaxed);
+    while(expired_quantums < now){
+        expired_quantums++;
+        sleeping_threads.expire(expired_quantums, &wake_sleeping_thread);
+    }
+    if(worker_count > 1){
+        next_wake_quantum.store(sleeping_threads.next_expiry(), std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+// Takes a thread out of blocked_threads, and makes it READY unless it sleeps as well. Must be called inside the
+// scheduler.
+void resume_blocked_thread(Thread* thread){
+    blocked_threads.remove(thread);
+    if(thread == running_thread){
+        // blocked by another worker, and resumed by itself before it was taken off the CPU
+        thread->state = State::RUNNING;
+    } else if(!sleeping_threads.contains(thread)){
+        // a thread that is also sleeping stays BLOCKED until wake_sleeping_threads wakes it
+        wake_thread(thread);
     }
-    return thread_in_blocked;
 }
 
-int decrease_sleeping() {
-    for(int i = 0; i < MAX_THREAD_NUM; i ++){
-        if(threads[i] != nullptr){
-            if(threads[i]->quantums_to_sleep > 0){
-                threads[i]->quantums_to_sleep--;
-                bool thread_in_blocked = is_thread_blocked(i);
-                if(threads[i]->quantums_to_sleep == 0 && !thread_in_blocked){
-                    threads[i]->state = State::READY;
-                    ready_threads.push_back(threads[i]);
-                }
+// Creates UTHREAD_INBOX_POOL_THREADS threads for the pool, called by the first uthread_post_spawn: a posted spawn that
+// is carried out at a preemption only takes a free thread of the pool, and with none there it would wait for a library
+// call that may never come. The poster allocates them, outside the scheduler, and drain_inbox moves them into the pool.
+void reserve_inbox_threads(){
+    Thread* reserved = nullptr;
+    for(int i = 0; i < UTHREAD_INBOX_POOL_THREADS; i++){
+        Thread* thread = new Thread();
+        if(!thread->prepare(0, nullptr, STACK_SIZE)){
+            printf("system error: memory allocation failed\n");
+            exit(1);
+        }
+        thread->next = reserved;
+        reserved = thread;
+    }
+    reserved_threads.store(reserved, std::memory_order_release);
+}
+
+// Carries the requests posted from outside the scheduler out (see uthread_post_resume and uthread_post_spawn), in the
+// order they were posted. Must be called inside the scheduler: leave_scheduler calls it, so a request is carried out
+// at the next switch point or library call on any worker, and so do the idle loops once a post woke them up. A thread
+// spawned here is queued on the calling worker. The threads reserve_inbox_threads created go into the pool first.
+// Without may_allocate (in the timer handler) a spawn that would allocate stops the draining: it is left in the inbox,
+// with the requests behind it, for the next library call or idle loop.
+void drain_inbox(bool may_allocate){
+    Thread* reserved = reserved_threads.exchange(nullptr, std::memory_order_acquire);
+    while(reserved != nullptr){
+        Thread* next = reserved->next;
+        thread_pool.release(reserved);
+        reserved = next;
+    }
+    InboxMessage message;
+    while(inbox.peek(&message)){
+        if(message.kind == INBOX_SPAWN){
+            Thread* thread = may_allocate ? create_thread(message.entry_point, STACK_SIZE)
+                                          : create_pooled_thread(message.entry_point);
+            if(thread == nullptr && !may_allocate){
+                return;
+            }
+            if(thread != nullptr){
+                enqueue_thread(thread);
             }
+        } else if(message.tid < (int) threads.size() && threads[message.tid] != nullptr &&
+                  id_generation(message.tid) == message.generation &&
+                  is_thread_blocked(message.tid)){
+            resume_blocked_thread(threads[message.tid]);
         }
+        inbox.take(&message);
     }
-    return 0;
 }
 
-void jump_to_next_thread(int state) {
+// Counts a quantum that starts, and tells the policy
+void count_quantum(){
+    int quantum;
+    if(worker_count > 1){
+        quantum = total_quantums.fetch_add(1, std::memory_order_relaxed) + 1;
+    } else {
+        // no other writer, and no need for a locked instruction
+        quantum = total_quantums.load(std::memory_order_relaxed) + 1;
+        total_quantums.store(quantum, std::memory_order_relaxed);
+    }
+    policy->on_quantum(quantum);
+}
 
-    //update run time of current thread before going to next one
-    if(state != TERMINATED_JMP)
-        threads[current_thread_id]->total_run_time ++;
-   // sigsetjmp(threads[current_thread_id]->env,1);
+// Runs one quantum with no thread to run: parks the process in ppoll for a quantum of wall-clock time, or until the
+// policy's next event or a post to the inbox if that comes first, then wakes the threads whose sleep ends with it and
+// carries the posted requests out. Idle quantums are counted like any other, so sleeps end on time, and the process
+// uses no CPU meanwhile. Must be called inside the scheduler with the ready queue empty. Returns false if no thread
+// sleeps or waits for the policy either, and no request was posted, as nothing could ever wake up then.
+bool idle_quantum() {
+    Worker& worker = me();
+    long long event = policy->next_event_ns(nullptr, 0);
+    if(sleeping_threads.empty() && event == LLONG_MAX && inbox.empty()){
+        return false;
+    }
+    count_quantum();
+    long long wait_ns = quantum_duration * 1000LL;
+    if(event != LLONG_MAX && event - worker.run_start_ns < wait_ns){
+        wait_ns = event > worker.run_start_ns ? event - worker.run_start_ns : 0;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = wait_ns / 1000000000LL;
+    timeout.tv_nsec = wait_ns % 1000000000LL;
+    // SIGVTALRM is blocked for the wait: a tick has nothing to preempt and would only cut the quantum short
+    inbox.wait(&timeout, &idle_mask);
+    preempt_pending = 0;
+    worker.run_start_ns = clock_ns(); // nobody is charged for the idle time
+    worker.cpu_start_ns = cpu_charging ? cpu_clock_ns() : 0;
+    wake_sleeping_threads();
+    drain_inbox();
+    policy->on_clock(worker.run_start_ns);
+    return true;
+}
 
-    //chose behaviour according to how we reached the function
-    int ret_val = 0;
-    switch (state) {
-        case BLOCKED_JMP:
-            uthread_block(current_thread_id);
-            ret_val = sigsetjmp(threads[current_thread_id]->env,1);
-            break;
-        case READY_JMP:
-            threads[current_thread_id]->state = State::READY;
-            ready_threads.push_back(threads[current_thread_id]);
-            ret_val = sigsetjmp(threads[current_thread_id]->env,1);
-            break;
-        case TERMINATED_JMP:
-            if (threads[current_thread_id] == nullptr){
+// Switches from one context to another, saving and loading the floating-point control state only if either thread
+// keeps its own (nullptr for the idle context of a worker)
+void switch_context(const Thread* from_thread, Context* from, const Thread* to_thread, Context* to){
+    if((from_thread != nullptr && from_thread->fp_env) || (to_thread != nullptr && to_thread->fp_env)){
+        // the one with an environment of its own keeps it, and the other one runs in the initial one
+        context_switch_fp(from, to);
+    } else {
+        context_switch(from, to);
+    }
+}
+
+// Starts a new quantum and switches the calling worker from its running thread, or from its idle loop, to the thread
+// at the head of its ready queue (or to the handoff thread). Must be called inside the scheduler with a thread to run.
+void run_next(){
+    Worker& worker = me();
+    count_quantum();
+
+    //choose new thread
+    Thread* next_thread;
+    int ticks = 0;
+    if(can_pick_handoff(worker)){
+        // a latency-critical thread that woke up, or the target of uthread_yield_to, goes before its turn
+        next_thread = worker.handoff;
+        ticks = worker.handoff_ticks;
+        policy->remove(next_thread);
+    } else {
+        next_thread = policy->dequeue_next();
+    }
+    worker.handoff = nullptr;
+    worker.handoff_ticks = 0;
+    worker.quantum_start_ns = worker.run_start_ns;
+    next_thread->state = State::RUNNING;
+    next_thread->total_run_time++;
+    if(ticks > 0){
+        // the rest of the yielding thread's quantum, on the timer period it started with
+        worker.budget_ticks = ticks;
+    } else {
+        if(adaptive){
+            adapt_quantum();
+        }
+        set_quantum_timer(next_thread);
+        worker.budget_ticks = quantum_budget(next_thread);
+    }
+
+    //activate new thread
+    Thread* previous = running_thread;
+    if(next_thread != previous){
+        // a terminated thread is only reaped once it is off the CPU, so its context can still be written to
+        Context* from = previous != nullptr ? &previous->context : &worker.idle_context;
+        if(previous != nullptr){
+            previous->off_cpu_ns = worker.run_start_ns;
+        }
+        worker.switched_from = previous;
+        // a thread another worker moved here at the end of its switch may still be on that worker's CPU, see
+        // requeue_running_thread
+        while(next_thread->on_cpu.load(std::memory_order_acquire)){
+            __builtin_ia32_pause();
+        }
+        if(next_thread->last_worker >= 0 && next_thread->last_worker != worker.index){
+            next_thread->migrations++;
+        }
+        next_thread->on_cpu.store(true, std::memory_order_relaxed);
+        next_thread->worker = worker.index;
+        next_thread->last_worker = worker.index;
+        running_thread = next_thread;
+        switch_context(previous, from, next_thread, &next_thread->context);
+        finish_switch();
+        if(adaptive){
+            // back on this thread, switched to by another one that was charged right before
+            Worker& back = me();
+            back.switch_cost_ns += (clock_ns() - back.run_start_ns - back.switch_cost_ns) / 8;
+        }
+    }
+}
+
+// Runs first in the context switched to, once the one switched from is saved: from here on the thread that left the
+// CPU may be resumed by another worker, or reaped (see reap_terminated_threads)
+void finish_switch(){
+    Worker& worker = me();
+    Thread* previous = worker.switched_from;
+    if(previous != nullptr){
+        worker.switched_from = nullptr;
+        previous->on_cpu.store(false, std::memory_order_release);
+    }
+}
+
+// In M:N mode, switches the calling worker from its running thread, which can't run anymore, to its idle loop
+void switch_to_idle(){
+    Worker& worker = me();
+    Thread* previous = running_thread;
+    previous->off_cpu_ns = worker.run_start_ns;
+    worker.switched_from = previous;
+    running_thread = nullptr;
+    worker.busy = false;
+    busy_workers--;
+    switch_context(previous, &previous->context, nullptr, &worker.idle_context);
+    finish_switch();
+}
+
+// In M:N mode, moves threads from the queue of another worker to the one of the calling worker, which holds at most
+// the thread that leaves the CPU. The victims are tried from a random one on, so that thieves spread over the busy
+// workers. A worker that has a thread to run meanwhile only takes cold threads, an idle one cache-hot ones as well (see
+// MultiQueuePolicy::steal). The workers on the thief's NUMA node come first, since the stolen threads' stacks are on
+// the node of their worker; the ones on other nodes are a last resort, only for an idle worker. A victim whose queue
+// lock is taken is skipped, so a thief never waits for another worker. Must be called inside the scheduler, right
+// after the running thread was charged. Returns whether a thread was stolen.
+bool try_steal(int victim, long long now_ns, bool idle){
+    SpinLock& lock = workers[victim].queue_lock;
+    if(!lock.try_lock()){
+        return false;
+    }
+    bool stolen = multi_queue_policy.steal(victim, now_ns, idle) > 0;
+    lock.unlock();
+    return stolen;
+}
+
+bool steal_threads(bool idle){
+    Worker& worker = me();
+    // xorshift32
+    worker.steal_seed ^= worker.steal_seed << 13;
+    worker.steal_seed ^= worker.steal_seed >> 17;
+    worker.steal_seed ^= worker.steal_seed << 5;
+    int first = (int) (worker.steal_seed % (unsigned int) worker_count);
+    bool remote_victims = false;
+    for(int i = 0; i < worker_count; i++){
+        int victim = (first + i) % worker_count;
+        if(victim == worker.index){
+            continue;
+        }
+        if(workers[victim].node != worker.node){
+            remote_victims = true;
+        } else if(try_steal(victim, worker.run_start_ns, idle)){
+            return true;
+        }
+    }
+    if(!idle || !remote_victims){
+        return false;
+    }
+    for(int i = 0; i < worker_count; i++){
+        int victim = (first + i) % worker_count;
+        if(victim != worker.index && workers[victim].node != worker.node &&
+           try_steal(victim, worker.run_start_ns, idle)){
+            return true;
+        }
+    }
+    return false;
+}
+
+void unpark_worker(Worker& worker){
+    worker.parked = false;
+    parked_workers--;
+    waking_workers++;
+    worker.wake_word = 1;
+    syscall(SYS_futex, &worker.wake_word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+// In M:N mode, wakes the parked workers that have something to do: those with threads in their own queue, one to
+// steal if a busy worker has threads waiting (unless one is on its way already), and one to count the quantums if no
+// worker runs a thread while some sleep. Called inside the scheduler on every way out of it (see leave_scheduler), so
+// it sees every change to the queues; it only looks at them while a worker is parked.
+void wake_idle_workers(){
+    if(parked_workers == 0){
+        return;
+    }
+    bool waiting = false;
+    for(int i = 0; i < worker_count; i++){
+        if(!multi_queue_policy.empty(i)){
+            if(workers[i].parked){
+                unpark_worker(workers[i]);
+            } else {
+                waiting = true;
+            }
+        }
+    }
+    bool count_quantums = busy_workers == 0 && !sleeping_threads.empty() && timed_worker < 0;
+    if(parked_workers > 0 && ((waiting && waking_workers == 0) || count_quantums)){
+        for(int i = 0; i < worker_count; i++){
+            if(workers[i].parked){
+                unpark_worker(workers[i]);
                 break;
             }
-            if (threads[current_thread_id]->state == RUNNING){
+        }
+    }
+}
+
+// Puts the calling worker, idle with nothing to steal, to sleep on its futex until another worker wakes it up (see
+// wake_idle_workers). While no worker runs a thread and some sleep, one parked worker wakes up every quantum to count
+// it instead, so that the sleeps end on time. Called inside the scheduler, the locks are released while the worker
+// sleeps.
+void park_worker(){
+    Worker& worker = me(); // the idle loop never changes workers
+    wake_idle_workers();
+    bool timed = busy_workers == 0 && !sleeping_threads.empty() && timed_worker < 0;
+    if(timed){
+        timed_worker = worker.index;
+    }
+    worker.parked = true;
+    worker.wake_word = 0;
+    parked_workers++;
+    // pairs with the fence in Inbox::post: either the inbox has the message, or its poster sees the worker parked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool posted = !inbox.empty();
+    unlock_scheduler();
+    struct timespec timeout;
+    timeout.tv_sec = quantum_duration / 1000000;
+    timeout.tv_nsec = quantum_duration % 1000000 * 1000L;
+    bool timed_out = false;
+    if(!posted){
+        // SIGVTALRM is blocked for the wait: there is nothing to preempt, and it would only cut the wait short
+        sigprocmask(SIG_BLOCK, &timer_signal, nullptr);
+        timed_out = syscall(SYS_futex, &worker.wake_word, FUTEX_WAIT_PRIVATE, 0, timed ? &timeout : nullptr,
+                            nullptr, 0) < 0 && errno == ETIMEDOUT;
+        sigprocmask(SIG_UNBLOCK, &timer_signal, nullptr);
+    }
+    lock_scheduler();
+    preempt_pending = 0;
+    if(worker.parked){
+        // timed out, interrupted, or woken up by a post to the inbox (see notify_inbox) rather than by another worker
+        worker.parked = false;
+        parked_workers--;
+    } else {
+        waking_workers--;
+    }
+    if(timed_worker == worker.index){
+        timed_worker = -1;
+    }
+    if(timed_out && busy_workers == 0 && !sleeping_threads.empty()){
+        count_quantum();
+    }
+}
+
+// Makes a worker carry a request just posted to the inbox out soon, called by the poster outside the scheduler. In M:N
+// mode that is a parked worker, if there is one: the poster can't take the lock, so it only sets the worker's futex
+// word, and the worker finds itself still parked when it wakes up. A worker that runs a thread drains the inbox at
+// its next switch anyway, as does worker 0 in 1:N mode - unless the timer is stopped in tickless mode, so there it is
+// kicked (see timer_handler). The idle worker 0 is woken up by the eventfd of the inbox.
+void notify_inbox(){
+    if(worker_count > 1){
+        for(int i = 0; i < worker_count; i++){
+            if(workers[i].parked){
+                workers[i].wake_word = 1;
+                syscall(SYS_futex, &workers[i].wake_word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
                 return;
-//                ready_threads.push_front(threads[current_thread_id]);
-//                threads[current_thread_id]->state = READY;
             }
+        }
+    } else if(tickless){
+        signal_worker(workers[0]);
+    }
+}
+
+// Takes the calling worker, in its idle loop, out of the way of uthread_terminate(0) on another worker: it stops its
+// timer and lets go of its locks, and its pthread returns from worker_main to be joined. Worker 0 runs on the kernel
+// thread that called uthread_init_ex, which can't end before the process, so it only waits for the exit instead.
+void stop_worker(){
+    Worker& worker = me();
+    worker.timer.stop();
+    unlock_scheduler();
+    worker.stopped = true;
+    if(worker.index == 0){
+        sigset_t all;
+        sigfillset(&all);
+        sigprocmask(SIG_BLOCK, &all, nullptr);
+        for(;;){
+            pause();
+        }
+    }
+}
+
+// Makes the other workers stop for uthread_terminate(0), see stop_worker, and waits until they did. Those that run a
+// thread are kicked, and take the scheduler lock in the timer handler; the parked ones are woken up. The caller lets
+// go of the lock meanwhile, and takes it again once it is the only worker left.
+void stop_other_workers(){
+    exiting_worker = worker_index;
+    for(int i = 0; i < worker_count; i++){
+        if(i == worker_index){
+            continue;
+        }
+        if(workers[i].busy){
+            signal_worker(workers[i]);
+        } else if(workers[i].parked){
+            unpark_worker(workers[i]);
+        }
+    }
+    unlock_scheduler();
+    for(int i = 0; i < worker_count; i++){
+        if(i == worker_index){
+            continue;
+        }
+        if(i == 0){
+            while(!workers[i].stopped){
+                sched_yield();
+            }
+        } else {
+            pthread_join(workers[i].pthread, nullptr);
+        }
+    }
+    lock_scheduler();
+}
 
+// The idle loop of a worker in M:N mode, on a stack of its own: runs the threads of the worker's queue, or threads it
+// steals from the others, and parks while there are none. It runs inside the scheduler, holding both its locks except
+// while parked: the worker only switches to it with them (see jump_to_next_thread).
+void worker_idle(){
+    finish_switch();
+    for(;;){
+        if(exiting_worker >= 0){
+            stop_worker();
+            return;
+        }
+        reap_terminated_threads();
+        charge_running_thread(nullptr);
+        wake_sleeping_threads();
+        drain_inbox();
+        policy->on_clock(me().run_start_ns);
+        if(!policy->empty() || can_pick_handoff(me()) || steal_threads(true)){
+            me().busy = true;
+            busy_workers++;
+            run_next();
+            // back here once the worker has nothing to run anymore
+            continue;
+        }
+        park_worker();
+    }
+}
+
+// Entry point of the pthread of a worker other than worker 0. It sets up what belongs to its kernel thread, and runs
+// the idle loop, on the pthread's stack.
+void* worker_main(void* arg){
+    worker_index = (int) (long) arg;
+    multi_queue_policy.set_worker(worker_index);
+    Worker& worker = me();
+    in_scheduler = 1;
+    if(pin_worker() < 0 || install_signal_stack() < 0 ||
+       worker.timer.start(timer_kind, worker.tick_usecs, SIGVTALRM) < 0){
+        printf("system error: worker %d failed to start\n", worker.index);
+        exit(1);
+    }
+    lock_scheduler();
+    worker_idle();
+    return nullptr;
+}
+
+// Whether the switch the calling worker is about to make needs scheduler_lock as well as the worker's queue lock: unless
+// the running thread goes back to the worker's queue - it still exists, wasn't blocked, may run on the worker, and
+// threads aren't scattered - and no sleep is due and no request was posted. Called with the worker's queue lock, which
+// guards the running thread.
+bool switch_needs_scheduler(){
+    Thread* current = current_thread();
+    return exiting_worker >= 0 || current == nullptr || current->state != State::RUNNING ||
+           (current->affinity >> worker_index & 1) == 0 || multi_queue_policy.scatters() || inbox.pending() ||
+           total_quantums.load(std::memory_order_relaxed) >= next_wake_quantum.load(std::memory_order_relaxed);
+}
+
+// Starts a new quantum and switches to the thread at the head of the ready queue.
+// Must be called inside the scheduler (see enter_scheduler). The switched-to thread leaves the scheduler on its own
+// way out: through leave_scheduler in the library call or timer handler it was suspended in, or in thread_main.
+// In M:N mode the running thread may have been blocked or terminated by another worker meanwhile: it then leaves the
+// CPU whatever the state it was called with. When the caller resumes, it may run on another worker.
+// A switch in M:N mode that only puts the running thread back in the worker's queue runs with the worker's queue lock
+// alone. Anything else takes scheduler_lock as well, see switch_needs_scheduler.
+void jump_to_next_thread(int state) {
+    if(worker_count > 1){
+        lock_own_queue();
+        if(!me().holds_scheduler_lock && switch_needs_scheduler()){
+            lock_scheduler();
+        }
+    }
+    Worker& worker = me();
+    Thread* current = current_thread();
+    if(current == nullptr){
+        state = TERMINATED_JMP;
+    } else if(current->state == State::BLOCKED){
+        state = BLOCKED_JMP;
+    } else if(current->state == State::RUNNING && (state == TERMINATED_JMP || state == KICKED_JMP)){
+        // terminating another thread does not end the current quantum, nor does a kick for a thread that runs on
+        return;
+    }
+    bool shared = holds_scheduler_lock();
+    if(state != TERMINATED_JMP && shared){
+        reap_terminated_threads();
+    }
+    charge_running_thread(current);
+
+    //chose behaviour according to how we reached the function
+    switch (state) {
+        case BLOCKED_JMP:
+            // the running thread was already moved out of the RUNNING state (blocked or sleeping)
+            policy->on_block(current);
             break;
-        case RUNNING_JMP:
-            ready_threads.push_back(threads[0]);
+        case READY_JMP:
+            // preempted at the end of its quantum
+            policy->on_tick(current);
+            current->state = State::READY;
+            requeue_running_thread(current);
+            break;
+        case PREEMPTED_JMP:
+            // taken off the CPU before the end of its quantum
+            current->state = State::READY;
+            requeue_running_thread(current);
             break;
         default:
             break;
     }
-//    if(ret_val == 0){
-//    }
 
     //general updates
-    decrease_sleeping();
-
-    //choose new thread
-    if(ret_val == 0){
-        total_quantums++;
-        Thread* next_thread = ready_threads.front();
-        if(next_thread == nullptr){
-            printf("thread library error: tried to run next thread but ready threads are empty");
-
+    if(shared){
+        wake_sleeping_threads();
+    }
+    policy->on_clock(worker.run_start_ns);
+    if(worker_count > 1){
+        if(policy->size() <= 1){
+            // the worker has no other thread to run, it takes some from a worker with a longer queue
+            steal_threads(policy->empty());
         }
-
-        ready_threads.remove(next_thread);
-        current_thread_id = next_thread->thread_id;
-        threads[current_thread_id]->state = State::RUNNING;
-        int timer_return_val = initiate_timer(quantum_duration);
-    //activate new thread
-        if(state != RUNNING_JMP)
-            siglongjmp(next_thread->env,1);}
+        if(worker.moving != nullptr){
+            // nothing makes the worker wait for a lock from here on
+            enqueue_thread(worker.moving);
+            worker.moving = nullptr;
+        }
+        if(policy->empty() && !can_pick_handoff(worker)){
+            // whichever worker picks the thread up later resumes it here
+            switch_to_idle();
+            return;
+        }
+    } else {
+        while(policy->empty()){
+            if(!idle_quantum()){
+                printf("thread library error: tried to run next thread but ready threads are empty\n");
+                return;
+            }
+        }
+    }
+    run_next();
 }
 
 /**
@@ -233,28 +1462,247 @@ void jump_to_next_thread(int state) {
  * @return On success, return 0. On failure, return -1.
 */
 int uthread_init(int quantum_usecs){
-    quantum_duration = quantum_usecs;
-    if(quantum_usecs < 0){
-        printf("thread library error: quantum_usecs must be positive\n",stderr);
+    uthread_options options = {};
+    options.quantum_usecs = quantum_usecs;
+    return uthread_init_ex(&options);
+}
+
+/**
+ * @brief initializes the thread library with the given options.
+ *
+ * Same as uthread_init, with the quantum taken from options->quantum_usecs. The thread table grows on demand up to
+ * options->max_threads threads (including the main thread), which may be far above MAX_THREAD_NUM.
+ * Spawned threads are taken from a pool that keeps the control blocks and stacks of terminated threads for reuse;
+ * options->pool_threads of them are created right away.
+ * Preemption is driven by a periodic timer on the clock chosen by options->timer, firing options->timer_ticks times
+ * per quantum. The timer is armed once; starting a quantum only resets the running thread's budget of ticks, so a
+ * thread switched to in the middle of a period loses the part of it that is gone.
+ * With options->tickless set, the timer is stopped while the running thread is the only one that can run and no
+ * thread sleeps, and restarted when a spawn, resume or wakeup gives it a competitor. The running thread's quantum
+ * doesn't end meanwhile, so the total number of quantums doesn't grow either.
+ * options->policy chooses how the next thread is picked: UTHREAD_POLICY_RR is the plain round robin.
+ * UTHREAD_POLICY_MLFQ is a multi-level feedback queue with options->levels levels: the highest non-empty level runs
+ * first, round robin within a level, and the quantum doubles with every level down. A thread that is preempted at the
+ * end of its quantum moves down a level, one that blocks or sleeps moves up one, and every options->boost_quantums
+ * quantums all threads are moved back to the top level.
+ * UTHREAD_POLICY_FAIR shares the CPU time among the threads in proportion to their weights (see uthread_attr): the
+ * thread that ran the least time for its weight runs next, and a thread is charged for the time it actually ran,
+ * not for whole quantums. It is charged on the clock of the timer: the CPU time of its worker under the CPU-time
+ * timers, which costs a system call per switch, so that time the kernel gave other processes isn't charged.
+ * With options->adaptive_quantum set, the quantum is sized every time a thread is switched to: the
+ * options->target_latency_usecs shared among the threads that can run, so that all of them run within it, but long
+ * enough that the measured cost of a switch stays below 1% of it, and between options->min_quantum_usecs and
+ * options->max_quantum_usecs. The timer period follows the quantum.
+ * With options->workers above 1 the threads run on that many kernel threads (M:N mode): the calling one and pthreads
+ * started here, each pinned to a CPU of its own with options->pin_workers set. Every worker runs the threads of its
+ * own ready queue round robin, preempted by a timer of its own (UTHREAD_TIMER_VIRTUAL counts the CPU time of each
+ * worker then). A thread is queued on the worker of the thread that spawned it, and on the worker it last ran on
+ * afterwards, so that it finds its stack and data in the caches of that worker's core. A worker whose queue runs
+ * empty steals the later half of the queue of another worker, picked at random, and sleeps while there is nothing to
+ * steal, until a thread is queued. Only an idle worker steals threads that left the CPU less than
+ * options->migration_cost_usecs ago, whose caches are still warm, and a thread only moves to a worker of its affinity
+ * (see uthread_set_affinity). With options->scatter_threads set, every thread that is queued goes to a random
+ * worker of its affinity instead, also when it leaves the CPU. A pinned worker places the stack and control block of
+ * a thread it spawns on the NUMA node of its CPU, and only steals from the workers on other nodes once it is idle and
+ * there is nothing to steal on its own. The library calls keep their semantics from any thread on any worker: a
+ * thread that is blocked or terminated by a thread on another worker is taken off its CPU right away. The total number
+ * of quantums, and so uthread_sleep, counts the quantums started on all workers. Thread-local variables and errno
+ * belong to the worker, a thread may find another one's after a switch. Library errors are written to the stdout
+ * descriptor directly, ahead of anything left in the stdout buffer. Deadline threads and groups are not available in
+ * M:N mode.
+ * It is an error to call this function with a null options, a non-positive quantum_usecs, an unknown timer or policy,
+ * more than 32 levels, a negative max_threads, pool_threads, timer_ticks, levels, boost_quantums, min_quantum_usecs,
+ * max_quantum_usecs, target_latency_usecs or migration_cost_usecs, a min_quantum_usecs above max_quantum_usecs, a
+ * negative workers or more than UTHREAD_MAX_WORKERS, or several workers with another policy or in tickless mode.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_ex(const uthread_options* options){
+    if(options == nullptr){
+        printf("thread library error: options is null\n");
+        return -1;
+    }
+    if(options->quantum_usecs <= 0){
+        printf("thread library error: quantum_usecs must be positive\n");
+        return -1;
+    }
+    if(options->max_threads < 0){
+        printf("thread library error: max_threads must not be negative\n");
+        return -1;
+    }
+    if(options->pool_threads < 0){
+        printf("thread library error: pool_threads must not be negative\n");
+        return -1;
+    }
+    if(options->timer < UTHREAD_TIMER_VIRTUAL || options->timer > UTHREAD_TIMER_MONOTONIC){
+        printf("thread library error: unknown timer\n");
+        return -1;
+    }
+    if(options->timer_ticks < 0){
+        printf("thread library error: timer_ticks must not be negative\n");
+        return -1;
+    }
+    if(options->policy < UTHREAD_POLICY_RR || options->policy > UTHREAD_POLICY_FAIR){
+        printf("thread library error: unknown policy\n");
+        return -1;
+    }
+    if(options->levels < 0 || options->levels > MAX_PRIORITY_LEVELS){
+        printf("thread library error: levels must not be negative or above %d\n", MAX_PRIORITY_LEVELS);
+        return -1;
+    }
+    if(options->boost_quantums < 0){
+        printf("thread library error: boost_quantums must not be negative\n");
         return -1;
     }
+    if(options->min_quantum_usecs < 0 || options->max_quantum_usecs < 0 || options->target_latency_usecs < 0){
+        printf("thread library error: min_quantum_usecs, max_quantum_usecs and target_latency_usecs must not be "
+               "negative\n");
+        return -1;
+    }
+    if(options->workers < 0 || options->workers > UTHREAD_MAX_WORKERS){
+        printf("thread library error: workers must not be negative or above %d\n", UTHREAD_MAX_WORKERS);
+        return -1;
+    }
+    if(options->migration_cost_usecs < 0){
+        printf("thread library error: migration_cost_usecs must not be negative\n");
+        return -1;
+    }
+    if(options->workers > 1 && (options->policy != UTHREAD_POLICY_RR || options->tickless)){
+        printf("thread library error: several workers only run the round robin policy, without tickless mode\n");
+        return -1;
+    }
+    int min_quantum = options->min_quantum_usecs > 0 ? options->min_quantum_usecs : (options->quantum_usecs + 3) / 4;
+    int max_quantum = options->max_quantum_usecs > 0 ? options->max_quantum_usecs : options->quantum_usecs * 4;
+    if(min_quantum > max_quantum){
+        printf("thread library error: min_quantum_usecs must not be above max_quantum_usecs\n");
+        return -1;
+    }
+    quantum_duration = options->quantum_usecs;
+    tickless = options->tickless != 0;
+    if(options->policy == UTHREAD_POLICY_MLFQ){
+        feedback_policy.init(options->levels > 0 ? options->levels : DEFAULT_LEVELS,
+                             options->boost_quantums > 0 ? options->boost_quantums : DEFAULT_BOOST_QUANTUMS);
+        base_policy = &feedback_policy;
+    } else if(options->policy == UTHREAD_POLICY_FAIR){
+        fair_policy.init(quantum_duration * 1000LL);
+        base_policy = &fair_policy;
+    }
+    worker_count = options->workers > 1 ? options->workers : 1;
+    if(worker_count > 1){
+        int migration_cost = options->migration_cost_usecs > 0 ? options->migration_cost_usecs
+                                                               : DEFAULT_MIGRATION_COST_USECS;
+        multi_queue_policy.init(worker_count, migration_cost * 1000LL, options->scatter_threads != 0);
+        base_policy = &multi_queue_policy;
+    }
+    policy = base_policy;
+    adaptive = options->adaptive_quantum != 0;
+    min_quantum_ns = min_quantum * 1000LL;
+    max_quantum_ns = max_quantum * 1000LL;
+    target_latency_ns = (options->target_latency_usecs > 0 ? options->target_latency_usecs
+                                                           : options->quantum_usecs * 4LL) * 1000;
+    quantum_ticks = options->timer_ticks > 0 ? options->timer_ticks : DEFAULT_TIMER_TICKS;
+    if(quantum_ticks > quantum_duration){
+        quantum_ticks = quantum_duration; // the timer period can't go below a micro-second
+    }
+    // the process' CPU time is signalled to any of its kernel threads, each worker needs a timer of its own
+    timer_kind = worker_count > 1 && options->timer == UTHREAD_TIMER_VIRTUAL ? UTHREAD_TIMER_THREAD_CPU : options->timer;
+    cpu_charging = options->policy == UTHREAD_POLICY_FAIR && timer_kind != UTHREAD_TIMER_MONOTONIC;
+    // worker i gets the i-th CPU the process may run on, modulo their number
+    int cpus[UTHREAD_MAX_WORKERS];
+    int cpu_count = 0;
+    cpu_set_t allowed;
+    if(options->pin_workers && sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+        for(int cpu = 0; cpu < CPU_SETSIZE && cpu_count < worker_count; cpu++){
+            if(CPU_ISSET(cpu, &allowed)){
+                cpus[cpu_count++] = cpu;
+            }
+        }
+    }
+    for(int i = 0; i < worker_count; i++){
+        workers[i].index = i;
+        workers[i].cpu = cpu_count > 0 ? cpus[i % cpu_count] : -1;
+        workers[i].node = -1;
+        workers[i].tick_usecs = quantum_duration / quantum_ticks;
+        workers[i].budget_ticks = quantum_ticks;
+        workers[i].policy_event_ns = LLONG_MAX;
+        workers[i].steal_seed = i + 1;
+        workers[i].adaptive_usecs = quantum_duration;
+    }
+    int capacity = options->max_threads > 0 ? options->max_threads : MAX_THREAD_NUM;
+    thread_ids.init(capacity);
+    id_generations.reset(new std::atomic<std::atomic<unsigned int>*>[(capacity - 1) / GENERATION_BLOCK + 1]());
+    snprintf(out_of_bounds_error, sizeof(out_of_bounds_error),
+             "thread library error: out of bounds thread id [0-%d only]\n", capacity - 1);
+    // the table never grows in M:N mode, see current_thread
+    threads.assign(worker_count > 1 || capacity < MAX_THREAD_NUM ? capacity : MAX_THREAD_NUM, nullptr);
+    grow_generations();
+
+    save_fp_control(&initial_fp_control);
+    // before anything is allocated, so that the pool, the stacks of worker 0 and the threads it spawns go on its node
+    if(pin_worker() < 0){
+        return -1;
+    }
+    if(!thread_pool.reserve(options->pool_threads, STACK_SIZE, workers[0].node)){
+        printf("system error: memory allocation failed\n");
+        exit(1);
+    }
+
+    thread_ids.allocate(); // the main thread takes id 0
     threads[0] = new Thread();
     if(threads[0] == nullptr){
-        printf("system error: memory allocation failed\n",stderr);
+        printf("system error: memory allocation failed\n");
         exit(1);
     }
     threads[0]->state = State::RUNNING;
-    threads[0]->total_run_time = 0;
-//    ready_threads.push_back(threads[0]);
+    threads[0]->total_run_time = 1;
+    threads[0]->worker = 0;
+    threads[0]->last_worker = 0;
+    threads[0]->on_cpu = true;
+    total_quantums.store(1, std::memory_order_relaxed);
+    Worker& worker = workers[0];
+    worker.pthread = pthread_self();
+    worker.busy = true;
+    running_thread = threads[0];
+    worker.run_start_ns = clock_ns();
+    worker.cpu_start_ns = cpu_charging ? cpu_clock_ns() : 0;
+    worker.quantum_start_ns = worker.run_start_ns;
+    if(worker_count > 1){
+        // worker 0 runs the main thread on the process stack, its idle loop needs a stack of its own
+        if(!worker.idle_stack.allocate(IDLE_STACK_SIZE, worker.node)){
+            printf("system error: memory allocation failed\n");
+            exit(1);
+        }
+        prepare_context(&worker.idle_context, worker.idle_stack.top(), &worker_idle);
+    }
     // Action to take when alarm sounds
+    sigemptyset(&timer_signal);
+    sigaddset(&timer_signal, SIGVTALRM);
+    sigprocmask(SIG_BLOCK, nullptr, &idle_mask);
+    sigaddset(&idle_mask, SIGVTALRM);
     sa.sa_handler = &timer_handler;
+    sa.sa_flags = 0;
     if (sigaction(SIGVTALRM, &sa, NULL) < 0)
     {
         printf("sigaction error.");
     }
-    //
-    initiate_timer(quantum_usecs);
-    jump_to_next_thread(RUNNING_JMP);
+    install_overflow_handler();
+    if(!inbox.init()){
+        printf("system error: eventfd failed\n");
+        exit(1);
+    }
+    if(worker.timer.start(timer_kind, worker.tick_usecs, SIGVTALRM) < 0){
+        printf("system error: timer failed to start\n");
+        return -1;
+    }
+    for(int i = 1; i < worker_count; i++){
+        if(pthread_create(&workers[i].pthread, nullptr, &worker_main, (void*) (long) i) != 0){
+            printf("system error: failed to start a worker\n");
+            exit(1);
+        }
+    }
+    enter_scheduler();
+    leave_scheduler(); // stops the timer right away in tickless mode, the main thread is alone
+    inbox_open.store(true, std::memory_order_release);
     return 0;
 }
 
@@ -264,32 +1712,82 @@ int uthread_init(int quantum_usecs){
  *
  * The thread is added to the end of the READY threads list.
  * The uthread_spawn function should fail if it would cause the number of concurrent threads to exceed the
- * limit (MAX_THREAD_NUM).
+ * limit (MAX_THREAD_NUM, or max_threads if the library was initialized with uthread_init_ex).
  * Each thread should be allocated with a stack of size STACK_SIZE bytes.
  * It is an error to call this function with a null entry_point.
  *
  * @return On success, return the ID of the created thread. On failure, return -1.
 */
 int uthread_spawn(thread_entry_point entry_point){
+    return uthread_spawn_ex(entry_point, nullptr);
+}
+
+/**
+ * @brief Creates a new thread like uthread_spawn, with the given attributes.
+ *
+ * The thread's stack is attrs->stack_size bytes, with an inaccessible guard page below it: a thread that overflows its
+ * stack terminates the process with a "stack overflow" diagnostic instead of corrupting memory.
+ * Under UTHREAD_POLICY_FAIR the thread gets a share of the CPU in proportion to attrs->weight. The thread joins the
+ * group attrs->group, see uthread_group_create.
+ * A thread with attrs->latency_critical set doesn't wait for its turn when it is resumed or its sleep ends: it runs
+ * next, and preempts the running thread as soon as that ran uthread_options.min_quantum_usecs of its quantum (within a
+ * timer tick), unless the running thread is latency-critical or a deadline thread itself. In M:N mode that is the
+ * running thread of the worker the thread is queued on, whichever worker resumed it or ended its sleep.
+ * Only threads with attrs->fp_env set may change their floating-point environment: each of them keeps its own, while
+ * all other threads run in the one the process had at uthread_init_ex, preempted or not. The floating-point and vector
+ * registers are kept for all threads.
+ * A null attrs is the same as all defaults. It is an error to call this function with a null entry_point, a negative
+ * stack_size or weight, or a group that doesn't exist.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_ex(thread_entry_point entry_point, const uthread_attr* attrs){
     if(entry_point == nullptr){
-        printf("thread library error: entry_point is null\n",stderr);
+        printf("thread library error: entry_point is null\n");
         return -1;
     }
-    int tid = first_available_id();
-    if(tid==-1){
-        printf("thread library error: maximum number of threads exceeded\n",stderr);
+    int stack_size = STACK_SIZE;
+    int weight = UTHREAD_DEFAULT_WEIGHT;
+    int group = 0;
+    bool latency_critical = false;
+    bool fp_env = false;
+    if(attrs != nullptr){
+        if(attrs->stack_size < 0){
+            printf("thread library error: stack_size must not be negative\n");
+            return -1;
+        }
+        if(attrs->weight < 0){
+            printf("thread library error: weight must not be negative\n");
+            return -1;
+        }
+        if(attrs->stack_size > 0){
+            stack_size = attrs->stack_size;
+        }
+        if(attrs->weight > 0){
+            weight = attrs->weight;
+        }
+        group = attrs->group;
+        latency_critical = attrs->latency_critical != 0;
+        fp_env = attrs->fp_env != 0;
+    }
+    enter_scheduler();
+    if(!group_policy.exists(group)){
+        report_error("thread library error: no such group\n");
+        leave_scheduler();
         return -1;
     }
-    block_mask_sig();
-    threads[tid] = new Thread(tid,entry_point);
-    if(threads[tid] == nullptr){
-        printf("system error: memory allocation failed\n",stderr);
-        unblock_mask_sig();
-        exit(1);
+    Thread* thread = create_thread(entry_point, stack_size);
+    if(thread == nullptr){
+        leave_scheduler();
+        return -1;
     }
-    ready_threads.push_back(threads[tid]);
-    unblock_mask_sig();
-    threads[tid]->total_run_time=1;
+    int tid = thread->thread_id;
+    threads[tid]->weight = weight;
+    threads[tid]->group = group;
+    threads[tid]->latency_critical = latency_critical;
+    threads[tid]->fp_env = fp_env;
+    enqueue_thread(threads[tid]);
+    leave_scheduler();
     return tid;
 }
 
@@ -298,21 +1796,32 @@ int uthread_spawn(thread_entry_point entry_point){
  *
  * All the resources allocated by the library for this thread should be released. If no thread with ID tid exists it
  * is considered an error. Terminating the main thread (tid == 0) will result in the termination of the entire
- * process using exit(0) (after releasing the assigned library memory).
+ * process using exit(0) (after releasing the assigned library memory). In M:N mode the other workers stop first: the
+ * threads they run are left where they are, and their pthreads are joined.
  *
  * @return The function returns 0 if the thread was successfully terminated and -1 otherwise. If a thread terminates
  * itself or the main thread is terminated, the function does not return.
 */
 int uthread_terminate(int tid){
+    // the checks are made inside the scheduler, another thread could terminate tid between them and the update
+    enter_scheduler();
     if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
         return -1;
     }
     if(tid == 0){
+        me().timer.stop();
+        if(worker_count > 1){
+            // the other workers may run threads on their stacks
+            stop_other_workers();
+        }
         terminate_all_threads();
         exit(0);
     }
     delete_single_thread(tid);
+    // does not return if the thread terminated itself
     jump_to_next_thread(TERMINATED_JMP);
+    leave_scheduler();
     return EXIT_SUCCESS;
 }
 
@@ -326,28 +1835,36 @@ int uthread_terminate(int tid){
  * @return On success, return 0. On failure, return - 1
 */
 int uthread_block(int tid){
+    enter_scheduler();
     if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
         return -1;
     }
 
     if (tid == 0) {
-        printf("thread library error: can't block the main thread\n", stderr);
+        report_error("thread library error: can't block the main thread\n");
+        leave_scheduler();
         return -1;
     }
-    if (threads[tid]->state != State::BLOCKED){
-
-        block_mask_sig();
+    // a sleeping thread is BLOCKED as well, being in blocked_threads is what marks an explicit block
+    if (!is_thread_blocked(tid)){
 
-        blocked_threads.push_back(threads[tid]);
-        threads[tid]->state = State::BLOCKED;
-        ready_threads.remove(threads[tid]);
-
-        unblock_mask_sig();
+        // a thread is in one queue at a time, take it out of the ready queue first
+        Thread* thread = threads[tid];
+        int worker = lock_thread_queue(thread);
+        policy->remove(thread);
+        thread->state = State::BLOCKED;
+        if(thread != running_thread){
+            kick_worker(thread);
+        }
+        unlock_queue(worker);
+        blocked_threads.push_back(thread);
 
-        if(tid==current_thread_id){
+        if(thread == running_thread){
             jump_to_next_thread(BLOCKED_JMP);
         }
     }
+    leave_scheduler();
     return 0;
 }
 
@@ -360,22 +1877,92 @@ int uthread_block(int tid){
  * @return On success, return 0. On failure, return -1.
 */
 int uthread_resume(int tid){
+    enter_scheduler();
     if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
         return -1;
     }
 
-    if(threads[tid]->state != State::BLOCKED){
+    if(!is_thread_blocked(tid)){
+        leave_scheduler();
         return 0;
     }
     //we reach here if the state was actually blocked
-    block_mask_sig();
 
-    threads[tid]->state = State::READY; // todo - new change
-    blocked_threads.remove(threads[tid]);
-    ready_threads.push_back(threads[tid]);
+    resume_blocked_thread(threads[tid]);
+
+    leave_scheduler();
+
+    return 0;
+}
 
-    unblock_mask_sig();
+/**
+ * @brief Resumes the thread with ID tid like uthread_resume, from any kernel thread of the process.
+ *
+ * The other functions of the library may only be called by its threads. This one may also be called by a pthread of
+ * the program that runs outside of it, such as one that waits for input on behalf of the threads: the request is
+ * queued in a lock-free inbox, and carried out at the next switch or library call, or right away if no thread was
+ * running - an idle worker is woken up by the post. Requests are carried out in the order they were posted. Such a
+ * pthread must keep SIGVTALRM blocked, the timer signal of the library may be sent to any kernel thread of the process.
+ * Resuming a thread that is not BLOCKED by then has no effect, as does resuming one that terminated meanwhile, even if
+ * a new thread took its ID since: the request is for the thread that had the ID when it was posted.
+ * It is an error to call this function before uthread_init_ex, with a tid out of bounds, or while
+ * UTHREAD_INBOX_CAPACITY requests wait already.
+ *
+ * @return On success (the request was queued), return 0. On failure, return -1.
+*/
+int uthread_post_resume(int tid){
+    if(!inbox_open.load(std::memory_order_acquire)){
+        printf("thread library error: the library is not initialized\n");
+        return -1;
+    }
+    if(tid < 0 || tid >= thread_ids.capacity()){
+        printf("%s", out_of_bounds_error);
+        return -1;
+    }
+    InboxMessage message = {INBOX_RESUME, tid, id_generation(tid), nullptr};
+    if(!inbox.post(message)){
+        printf("thread library error: the inbox is full\n");
+        return -1;
+    }
+    notify_inbox();
+    return 0;
+}
 
+/**
+ * @brief Creates a new thread like uthread_spawn, from any kernel thread of the process.
+ *
+ * The request is queued and carried out like those of uthread_post_resume, so the caller doesn't learn the ID of the
+ * new thread. If the maximum number of threads is reached by then, the error is reported when the request is carried
+ * out. The timer handler can't allocate memory, so at a preemption the request is only carried out with a thread of
+ * the pool (see uthread_options.pool_threads) that is free already, and an id the thread table has a slot for;
+ * otherwise it waits, with the requests posted after it, for the next library call or an idle worker. The first call
+ * therefore adds UTHREAD_INBOX_POOL_THREADS threads to the pool, allocated by the caller, so that that many posted
+ * threads can be alive at once while no thread calls the library. The pool is shared with uthread_spawn, and in 1:N
+ * mode the table has slots for MAX_THREAD_NUM threads until a library call grows it.
+ * It is an error to call this function before uthread_init_ex, with a null entry_point, or while
+ * UTHREAD_INBOX_CAPACITY requests wait already.
+ *
+ * @return On success (the request was queued), return 0. On failure, return -1.
+*/
+int uthread_post_spawn(thread_entry_point entry_point){
+    if(!inbox_open.load(std::memory_order_acquire)){
+        printf("thread library error: the library is not initialized\n");
+        return -1;
+    }
+    if(entry_point == nullptr){
+        printf("thread library error: entry_point is null\n");
+        return -1;
+    }
+    if(!inbox_reserved.exchange(true)){
+        reserve_inbox_threads();
+    }
+    InboxMessage message = {INBOX_SPAWN, 0, 0, entry_point};
+    if(!inbox.post(message)){
+        printf("thread library error: the inbox is full\n");
+        return -1;
+    }
+    notify_inbox();
     return 0;
 }
 
@@ -393,17 +1980,87 @@ int uthread_resume(int tid){
  * @return On success, return 0. On failure, return -1.
 */
 int uthread_sleep(int num_quantums){
-    if(current_thread_id == 0){
-        printf("thread library error: the main thread cannot go to sleep\n", stderr);
+    if(uthread_get_tid() == 0){
+        printf("thread library error: the main thread cannot go to sleep\n");
         return -1;
     }
 
-    block_mask_sig();
+    enter_scheduler();
 
-    threads[current_thread_id]->quantums_to_sleep = num_quantums + 1;
+    // the quantum that starts right now is the first one counted
+    Thread* current = current_thread();
+    current->wake_quantum = total_quantums.load(std::memory_order_relaxed) + num_quantums;
+    current->state = State::BLOCKED;
+    sleeping_threads.insert(current);
     jump_to_next_thread(BLOCKED_JMP);
 
-    unblock_mask_sig();
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Gives up the rest of the calling thread's quantum.
+ *
+ * The calling thread is added to the READY threads as if it was preempted, and the next thread runs. A new quantum
+ * starts, for the calling thread itself if no other thread can run.
+ *
+ * @return 0.
+*/
+int uthread_yield(){
+    enter_scheduler_to_switch();
+    jump_to_next_thread(PREEMPTED_JMP);
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Hands the rest of the calling thread's quantum to the thread with ID tid.
+ *
+ * The thread with ID tid runs right away, ahead of the other READY threads, for what is left of the calling thread's
+ * quantum, and the calling thread is added to the READY threads as if it was preempted. Switching to the thread with
+ * ID tid starts a new quantum, which is counted by uthread_get_total_quantums and uthread_get_quantums as usual. If
+ * the scheduling policy can't let the thread go first (its group used up its quota, or a deadline thread has a job to
+ * run), or the thread may not run on the calling thread's worker (see uthread_set_affinity), the call is the same as
+ * uthread_yield.
+ * It is an error to call this function with the calling thread's ID or with a thread that is not READY. If no thread
+ * with ID tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid){
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    if(threads[tid] == running_thread){
+        report_error("thread library error: a thread can't yield to itself\n");
+        leave_scheduler();
+        return -1;
+    }
+    Thread* thread = threads[tid];
+    int queue = lock_thread_queue(thread);
+    bool ready = thread->state == State::READY;
+    // in M:N mode the thread can only be handed the CPU from the calling worker's queue
+    bool moved = ready && worker_count > 1 && queue != worker_index && (thread->affinity >> worker_index & 1) != 0;
+    if(moved){
+        policy->remove(thread);
+    }
+    unlock_queue(queue);
+    if(!ready){
+        report_error("thread library error: thread is not ready\n");
+        leave_scheduler();
+        return -1;
+    }
+    if(moved){
+        thread->worker = worker_index;
+        policy->enqueue(thread);
+    }
+    Worker& worker = me();
+    worker.handoff = thread;
+    worker.handoff_ticks = worker.budget_ticks > 0 ? worker.budget_ticks : 1;
+    jump_to_next_thread(PREEMPTED_JMP);
+    leave_scheduler();
     return 0;
 }
 
@@ -413,7 +2070,7 @@ int uthread_sleep(int num_quantums){
  * @return The ID of the calling thread.
 */
 int uthread_get_tid(){
-    return current_thread_id;
+    return running_thread->thread_id;
 }
 
 /**
@@ -425,7 +2082,7 @@ int uthread_get_tid(){
  * @return The total number of quantums.
 */
 int uthread_get_total_quantums(){
-    return total_quantums;
+    return total_quantums.load(std::memory_order_relaxed);
 }
 
 /**
@@ -438,8 +2095,329 @@ int uthread_get_total_quantums(){
  * @return On success, return the number of quantums of the thread with ID tid. On failure, return -1.
 */
 int uthread_get_quantums(int tid){
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    int quantums = threads[tid]->total_run_time;
+    leave_scheduler();
+    return quantums;
+}
+
+/**
+ * @brief Sets the length of a quantum in micro-seconds of the threads without one of their own.
+ *
+ * The quantum that is running is not cut short or stretched, the new length applies from the next quantum on. In
+ * adaptive mode (see uthread_options.adaptive_quantum) the library starts sizing the quantum again from usecs.
+ * It is an error to call this function with a non-positive usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_default_quantum(int usecs){
+    if(usecs <= 0){
+        printf("thread library error: quantum_usecs must be positive\n");
+        return -1;
+    }
+    enter_scheduler();
+    quantum_duration = usecs;
+    for(int i = 0; i < worker_count; i++){
+        workers[i].adaptive_usecs = usecs;
+    }
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Sets the length of a quantum in micro-seconds of the thread with ID tid, or back to the default if usecs is 0.
+ *
+ * A thread with a quantum of its own uses it regardless of the default quantum (see uthread_set_default_quantum) and
+ * of the adaptive quantum. A quantum is rounded down to whole timer ticks (see uthread_options.timer_ticks). The
+ * quantums keep being counted as before: uthread_get_total_quantums and uthread_get_quantums count the quantums
+ * started, whatever their length. It is an error to call this function with a negative usecs. If no thread with ID
+ * tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_quantum(int tid, int usecs){
+    if(usecs < 0){
+        printf("thread library error: quantum_usecs must not be negative\n");
+        return -1;
+    }
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    threads[tid]->quantum_usecs = usecs;
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Returns the time the thread with ID tid was in RUNNING state, in micro-seconds.
+ *
+ * If the thread with ID tid is in RUNNING state when this function is called, include also the current quantum so far.
+ * If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the run time of the thread with ID tid. On failure, return -1.
+*/
+long long uthread_get_run_usecs(int tid){
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    // the running thread's time up to now is included
+    charge_running_thread(current_thread());
+    long long usecs = threads[tid]->run_time_ns / 1000;
+    leave_scheduler();
+    return usecs;
+}
+
+/**
+ * @brief Sets the workers the thread with ID tid may run on: bit i of workers stands for worker i (see
+ * uthread_options.workers).
+ *
+ * A thread keeps running on the worker it last ran on as long as that one is in its affinity, so that its stack and
+ * data stay in the caches of that worker's core. With uthread_options.pin_workers every worker runs on a CPU of its
+ * own, so the affinity is a set of CPUs. A READY thread queued on a worker that is no longer in its affinity moves to
+ * the one of its affinity with the fewest READY threads right away; the calling thread moves right away as well, as
+ * if it called uthread_yield, and a thread running on another worker moves at the end of its quantum. Bits of
+ * workers that don't exist are ignored. All threads start with all workers in their affinity.
+ * It is an error to call this function with none of the existing workers in workers. If no thread with ID tid exists
+ * it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_affinity(int tid, unsigned long long workers){
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    unsigned long long existing = worker_count == UTHREAD_MAX_WORKERS ? ~0ULL : (1ULL << worker_count) - 1;
+    if((workers & existing) == 0){
+        report_error("thread library error: the affinity has none of the workers\n");
+        leave_scheduler();
+        return -1;
+    }
+    Thread* thread = threads[tid];
+    int queue = lock_thread_queue(thread);
+    thread->affinity = workers & existing;
+    bool moved = thread->worker >= 0 && (thread->affinity >> thread->worker & 1) == 0;
+    bool queued = moved && policy->contains(thread);
+    if(queued){
+        policy->remove(thread);
+    }
+    unlock_queue(queue);
+    if(queued){
+        // queued again on a worker of its affinity
+        enqueue_thread(thread);
+    } else if(moved && thread == running_thread){
+        jump_to_next_thread(PREEMPTED_JMP);
+    }
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Returns the number of times the thread with ID tid was switched to on another worker than the one it last
+ * ran on.
+ *
+ * Threads only change workers in M:N mode (see uthread_options.workers): when a worker steals them, or when their
+ * affinity changes (see uthread_set_affinity). If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the number of migrations of the thread with ID tid. On failure, return -1.
+*/
+int uthread_get_migrations(int tid){
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    int migrations = threads[tid]->migrations;
+    leave_scheduler();
+    return migrations;
+}
+
+/**
+ * @brief Makes the thread with ID tid a deadline thread, or a regular one again if params is null.
+ *
+ * A deadline thread runs periodic jobs: a job is released every params->period_usecs, starting right away, may use
+ * params->runtime_usecs of CPU time and is due params->deadline_usecs after its release. Deadline threads that have a
+ * job to run go before all other threads, the earliest deadline first, and preempt a thread with a later deadline or
+ * none as soon as the scheduler sees them: within a timer tick (see uthread_options.timer_ticks). A thread ends its
+ * job with uthread_wait_period, and a job that uses up its runtime is suspended until the next release, so a deadline
+ * thread can't take more than its share of the CPU from the others.
+ * A thread is only admitted if the sum of runtime / deadline over all deadline threads stays at most 1, so that every
+ * deadline can be met. Jobs that are not done by their deadline are counted, see uthread_get_deadline_misses.
+ * It is an error to call this function with a non-positive runtime_usecs or period_usecs, a negative deadline_usecs,
+ * a runtime longer than the deadline or a deadline longer than the period, if the thread is not admitted, or with
+ * several workers (see uthread_options.workers). If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_deadline(int tid, const uthread_deadline* params){
+    long long runtime_ns = 0;
+    long long deadline_ns = 0;
+    long long period_ns = 0;
+    if(params != nullptr){
+        if(params->runtime_usecs <= 0 || params->period_usecs <= 0 || params->deadline_usecs < 0){
+            printf("thread library error: runtime_usecs and period_usecs must be positive, deadline_usecs must not be "
+                   "negative\n");
+            return -1;
+        }
+        runtime_ns = params->runtime_usecs * 1000LL;
+        period_ns = params->period_usecs * 1000LL;
+        deadline_ns = params->deadline_usecs > 0 ? params->deadline_usecs * 1000LL : period_ns;
+        if(runtime_ns > deadline_ns || deadline_ns > period_ns){
+            printf("thread library error: runtime must fit in the deadline, and the deadline in the period\n");
+            return -1;
+        }
+    }
+    if(worker_count > 1){
+        printf("thread library error: deadline threads are not available with several workers\n");
+        return -1;
+    }
+    enter_scheduler();
+    if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    Thread* thread = threads[tid];
+    // the running thread is charged to its old class up to here
+    charge_running_thread(current_thread());
+    // a READY thread is queued again in its new class
+    bool ready = policy->contains(thread);
+    policy->remove(thread);
+    bool admitted = deadline_policy.set_params(thread, runtime_ns, deadline_ns, period_ns);
+    if(admitted && !deadlines_used){
+        deadlines_used = true;
+        stack_policies();
+    }
+    if(ready){
+        policy->enqueue(thread);
+    }
+    if(!admitted){
+        report_error("thread library error: deadline threads would need more than the whole CPU\n");
+        leave_scheduler();
+        return -1;
+    }
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Ends the current job of the calling deadline thread, which waits for the release of its next job.
+ *
+ * A job that ends after its deadline is counted as a miss. It is an error to call this function from a thread
+ * without a deadline.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_wait_period(){
+    enter_scheduler();
+    Thread* current = current_thread();
+    if(current->dl_period_ns == 0){
+        report_error("thread library error: the calling thread has no deadline\n");
+        leave_scheduler();
+        return -1;
+    }
+    deadline_policy.finish_job(current);
+    jump_to_next_thread(PREEMPTED_JMP);
+    leave_scheduler();
+    return 0;
+}
+
+/**
+ * @brief Returns the number of jobs of the thread with ID tid that were not done by their deadline.
+ *
+ * If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the number of missed deadlines of the thread with ID tid. On failure, return -1.
+*/
+int uthread_get_deadline_misses(int tid){
+    enter_scheduler();
     if(handle_valid_thread_id(tid) < 0){
+        leave_scheduler();
+        return -1;
+    }
+    int misses = threads[tid]->dl_misses;
+    leave_scheduler();
+    return misses;
+}
+
+/**
+ * @brief Creates a thread group, which threads join when they are spawned (see uthread_attr.group).
+ *
+ * The CPU is shared among the groups first, in proportion to attrs->shares, and then among the threads of each group
+ * in proportion to their weights, so a group gets the same share however many threads it has. The threads spawned
+ * without a group are in group 0, whose share is UTHREAD_DEFAULT_WEIGHT and which schedules them by the policy chosen
+ * by uthread_init_ex. A group with attrs->quota_usecs uses at most that much CPU time per attrs->period_usecs, even
+ * if the CPU is idle otherwise. Deadline threads (see uthread_set_deadline) run before all groups.
+ * A null attrs is the same as all defaults. It is an error to call this function with a negative shares,
+ * quota_usecs or period_usecs, if there are UTHREAD_MAX_GROUPS groups already, or with several workers (see
+ * uthread_options.workers).
+ *
+ * @return On success, return the ID of the created group. On failure, return -1.
+*/
+int uthread_group_create(const uthread_group_attr* attrs){
+    int shares = UTHREAD_DEFAULT_WEIGHT;
+    long long quota_ns = 0;
+    long long period_ns = UTHREAD_DEFAULT_GROUP_PERIOD_USECS * 1000LL;
+    if(attrs != nullptr){
+        if(attrs->shares < 0 || attrs->quota_usecs < 0 || attrs->period_usecs < 0){
+            printf("thread library error: shares, quota_usecs and period_usecs must not be negative\n");
+            return -1;
+        }
+        if(attrs->shares > 0){
+            shares = attrs->shares;
+        }
+        quota_ns = attrs->quota_usecs * 1000LL;
+        if(attrs->period_usecs > 0){
+            period_ns = attrs->period_usecs * 1000LL;
+        }
+    }
+    if(worker_count > 1){
+        printf("thread library error: groups are not available with several workers\n");
+        return -1;
+    }
+    enter_scheduler();
+    int gid = group_policy.create(shares, quota_ns, period_ns);
+    if(gid < 0){
+        report_error("thread library error: maximum number of groups exceeded\n");
+        leave_scheduler();
+        return -1;
+    }
+    if(!groups_used){
+        // the running thread is charged to its old class up to here
+        charge_running_thread(current_thread());
+        groups_used = true;
+        stack_policies();
+    }
+    leave_scheduler();
+    return gid;
+}
+
+/**
+ * @brief Returns the CPU time the threads of the group with ID gid ran for, in micro-seconds.
+ *
+ * The time of threads that terminated is included. It is an error to call this function with a group that doesn't
+ * exist.
+ *
+ * @return On success, return the CPU time of the group. On failure, return -1.
+*/
+long long uthread_group_get_usage(int gid){
+    enter_scheduler();
+    if(!group_policy.exists(gid)){
+        report_error("thread library error: no such group\n");
+        leave_scheduler();
         return -1;
     }
-    return threads[tid]->total_run_time;
-}
\ No newline at end of file
+    // the running thread's time up to now is included
+    charge_running_thread(current_thread());
+    long long usage = group_policy.usage_ns(gid) / 1000;
+    leave_scheduler();
+    return usage;
+}
@@ -12,6 +12,93 @@
 
 typedef void (*thread_entry_point)(void);
 
+/* Clocks that can drive preemption, see uthread_options.timer */
+#define UTHREAD_TIMER_VIRTUAL 0 /* CPU time of the process (setitimer ITIMER_VIRTUAL), the default */
+#define UTHREAD_TIMER_THREAD_CPU 1 /* CPU time of the kernel thread that called uthread_init_ex, signalled to it */
+#define UTHREAD_TIMER_MONOTONIC 2 /* wall-clock time, so quantums also run out while blocked in a system call */
+
+/* Scheduling policies, see uthread_options.policy */
+#define UTHREAD_POLICY_RR 0 /* round robin, the default */
+#define UTHREAD_POLICY_MLFQ 1 /* multi-level feedback queue */
+#define UTHREAD_POLICY_FAIR 2 /* CPU time shared in proportion to the threads' weights */
+
+#define UTHREAD_DEFAULT_WEIGHT 1024 /* weight of the main thread and of threads spawned without one */
+
+#define UTHREAD_MAX_GROUPS 64 /* maximal number of thread groups, including the default group 0 */
+#define UTHREAD_DEFAULT_GROUP_PERIOD_USECS 100000 /* accounting period of a group quota, unless given another */
+
+#define UTHREAD_MAX_WORKERS 64 /* maximal number of kernel threads running uthreads, see uthread_options.workers */
+
+#define UTHREAD_INBOX_CAPACITY 256 /* requests of uthread_post_resume and uthread_post_spawn that can wait */
+#define UTHREAD_INBOX_POOL_THREADS 16 /* threads the first uthread_post_spawn adds to the pool */
+
+/**
+ * @brief Options for uthread_init_ex. Zero-initialize it and set the fields you need - a field left 0 gets its default.
+ */
+typedef struct uthread_options {
+    int quantum_usecs; /* length of a quantum in micro-seconds, must be positive */
+    int max_threads; /* maximal number of concurrent threads including the main thread, default MAX_THREAD_NUM */
+    int pool_threads; /* threads (control block and STACK_SIZE stack) to create up front for later spawns, default 0 */
+    int timer; /* UTHREAD_TIMER_* clock that preempts the running thread, default UTHREAD_TIMER_VIRTUAL */
+    int timer_ticks; /* timer signals per quantum, default 4. A thread switched in mid-period, after another one
+                      * blocked or yielded, gets its quantum to within 1/timer_ticks of a quantum, at the cost of more
+                      * signals */
+    int tickless; /* non-zero: no timer signals while a single thread can run and none sleeps, default 0 */
+    int policy; /* UTHREAD_POLICY_* that picks the next thread to run, default UTHREAD_POLICY_RR */
+    int levels; /* priority levels of UTHREAD_POLICY_MLFQ, at most 32, default 8 */
+    int boost_quantums; /* UTHREAD_POLICY_MLFQ quantums between two moves of all threads to the top level, default 100 */
+    int adaptive_quantum; /* non-zero: the quantum follows the number of threads that can run, default 0 */
+    int min_quantum_usecs; /* shortest adaptive quantum, and the time a thread runs before a latency-critical thread
+                            * that wakes up preempts it (see uthread_attr), default quantum_usecs / 4 */
+    int max_quantum_usecs; /* longest adaptive quantum, default 4 * quantum_usecs */
+    int target_latency_usecs; /* time in which every thread that can run should get the CPU under an adaptive quantum,
+                               * default 4 * quantum_usecs */
+    int workers; /* kernel threads that run the uthreads, at most UTHREAD_MAX_WORKERS, default 1: all uthreads share
+                  * the kernel thread that called uthread_init_ex */
+    int pin_workers; /* non-zero: worker i only runs on the i-th CPU the process may run on (modulo their number),
+                      * the calling kernel thread included, and allocates thread memory on the NUMA node of that CPU,
+                      * default 0 */
+    int migration_cost_usecs; /* a thread that left the CPU less than this long ago is only moved to another worker by
+                               * an idle one, default 500 */
+    int scatter_threads; /* non-zero: in M:N mode a thread that is queued goes to a random worker of its affinity
+                          * instead of the one it last ran on, placement that ignores cache affinity, default 0 */
+} uthread_options;
+
+/**
+ * @brief Per-thread attributes for uthread_spawn_ex. Zero-initialize it and set the fields you need - a field left 0
+ * gets its default.
+ */
+typedef struct uthread_attr {
+    int stack_size; /* usable stack size in bytes, rounded up to whole pages, default STACK_SIZE */
+    int weight; /* share of the CPU relative to other threads under UTHREAD_POLICY_FAIR, default
+                 * UTHREAD_DEFAULT_WEIGHT: a thread of weight 2048 gets twice the CPU time of one of weight 1024 */
+    int group; /* thread group to join, see uthread_group_create, default the group 0 of all other threads */
+    int latency_critical; /* non-zero: when the thread is resumed or its sleep ends, it runs next and preempts the
+                           * running thread once that ran min_quantum_usecs of its quantum, default 0 */
+    int fp_env; /* non-zero: the thread changes its floating-point environment (rounding mode, exception masks, see
+                 * fenv.h) and keeps it across switches. Default 0: the thread runs in the environment the process had
+                 * at uthread_init_ex, and switches to and from it don't save or load any floating-point state */
+} uthread_attr;
+
+/**
+ * @brief Attributes of a thread group for uthread_group_create. Zero-initialize it and set the fields you need - a
+ * field left 0 gets its default.
+ */
+typedef struct uthread_group_attr {
+    int shares; /* share of the CPU relative to other groups, default UTHREAD_DEFAULT_WEIGHT (the share of group 0) */
+    int quota_usecs; /* CPU time the group may use per period at most, default no limit */
+    int period_usecs; /* accounting period of the quota, default UTHREAD_DEFAULT_GROUP_PERIOD_USECS */
+} uthread_group_attr;
+
+/**
+ * @brief Parameters of a deadline thread, for uthread_set_deadline. All times are in micro-seconds.
+ */
+typedef struct uthread_deadline {
+    int runtime_usecs; /* CPU time each job may use, must be positive */
+    int deadline_usecs; /* time from the release of a job until it is due, default period_usecs */
+    int period_usecs; /* time between two releases, must be positive */
+} uthread_deadline;
+
 /* External interface */
 
 
@@ -29,13 +116,65 @@ typedef void (*thread_entry_point)(void);
 */
 int uthread_init(int quantum_usecs);
 
+/**
+ * @brief initializes the thread library with the given options.
+ *
+ * Same as uthread_init, with the quantum taken from options->quantum_usecs. The thread table grows on demand up to
+ * options->max_threads threads (including the main thread), which may be far above MAX_THREAD_NUM.
+ * Spawned threads are taken from a pool that keeps the control blocks and stacks of terminated threads for reuse;
+ * options->pool_threads of them are created right away.
+ * Preemption is driven by a periodic timer on the clock chosen by options->timer, firing options->timer_ticks times
+ * per quantum. The timer is armed once; starting a quantum only resets the running thread's budget of ticks, so a
+ * thread switched to in the middle of a period loses the part of it that is gone.
+ * With options->tickless set, the timer is stopped while the running thread is the only one that can run and no
+ * thread sleeps, and restarted when a spawn, resume or wakeup gives it a competitor. The running thread's quantum
+ * doesn't end meanwhile, so the total number of quantums doesn't grow either.
+ * options->policy chooses how the next thread is picked: UTHREAD_POLICY_RR is the plain round robin.
+ * UTHREAD_POLICY_MLFQ is a multi-level feedback queue with options->levels levels: the highest non-empty level runs
+ * first, round robin within a level, and the quantum doubles with every level down. A thread that is preempted at the
+ * end of its quantum moves down a level, one that blocks or sleeps moves up one, and every options->boost_quantums
+ * quantums all threads are moved back to the top level.
+ * UTHREAD_POLICY_FAIR shares the CPU time among the threads in proportion to their weights (see uthread_attr): the
+ * thread that ran the least time for its weight runs next, and a thread is charged for the time it actually ran,
+ * not for whole quantums. It is charged on the clock of the timer: the CPU time of its worker under the CPU-time
+ * timers, which costs a system call per switch, so that time the kernel gave other processes isn't charged.
+ * With options->adaptive_quantum set, the quantum is sized every time a thread is switched to: the
+ * options->target_latency_usecs shared among the threads that can run, so that all of them run within it, but long
+ * enough that the measured cost of a switch stays below 1% of it, and between options->min_quantum_usecs and
+ * options->max_quantum_usecs. The timer period follows the quantum.
+ * With options->workers above 1 the threads run on that many kernel threads (M:N mode): the calling one and pthreads
+ * started here, each pinned to a CPU of its own with options->pin_workers set. Every worker runs the threads of its
+ * own ready queue round robin, preempted by a timer of its own (UTHREAD_TIMER_VIRTUAL counts the CPU time of each
+ * worker then). A thread is queued on the worker of the thread that spawned it, and on the worker it last ran on
+ * afterwards, so that it finds its stack and data in the caches of that worker's core. A worker whose queue runs
+ * empty steals the later half of the queue of another worker, picked at random, and sleeps while there is nothing to
+ * steal, until a thread is queued. Only an idle worker steals threads that left the CPU less than
+ * options->migration_cost_usecs ago, whose caches are still warm, and a thread only moves to a worker of its affinity
+ * (see uthread_set_affinity). With options->scatter_threads set, every thread that is queued goes to a random
+ * worker of its affinity instead, also when it leaves the CPU. A pinned worker places the stack and control block of
+ * a thread it spawns on the NUMA node of its CPU, and only steals from the workers on other nodes once it is idle and
+ * there is nothing to steal on its own. The library calls keep their semantics from any thread on any worker: a
+ * thread that is blocked or terminated by a thread on another worker is taken off its CPU right away. The total number
+ * of quantums, and so uthread_sleep, counts the quantums started on all workers. Thread-local variables and errno
+ * belong to the worker, a thread may find another one's after a switch. Library errors are written to the stdout
+ * descriptor directly, ahead of anything left in the stdout buffer. Deadline threads and groups are not available in
+ * M:N mode.
+ * It is an error to call this function with a null options, a non-positive quantum_usecs, an unknown timer or policy,
+ * more than 32 levels, a negative max_threads, pool_threads, timer_ticks, levels, boost_quantums, min_quantum_usecs,
+ * max_quantum_usecs, target_latency_usecs or migration_cost_usecs, a min_quantum_usecs above max_quantum_usecs, a
+ * negative workers or more than UTHREAD_MAX_WORKERS, or several workers with another policy or in tickless mode.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_ex(const uthread_options* options);
+
 /**
  * @brief Creates a new thread, whose entry point is the function entry_point with the signature
  * void entry_point(void).
  *
  * The thread is added to the end of the READY threads list.
  * The uthread_spawn function should fail if it would cause the number of concurrent threads to exceed the
- * limit (MAX_THREAD_NUM).
+ * limit (MAX_THREAD_NUM, or max_threads if the library was initialized with uthread_init_ex).
  * Each thread should be allocated with a stack of size STACK_SIZE bytes.
  * It is an error to call this function with a null entry_point.
  *
@@ -43,13 +182,35 @@ int uthread_init(int quantum_usecs);
 */
 int uthread_spawn(thread_entry_point entry_point);
 
+/**
+ * @brief Creates a new thread like uthread_spawn, with the given attributes.
+ *
+ * The thread's stack is attrs->stack_size bytes, with an inaccessible guard page below it: a thread that overflows its
+ * stack terminates the process with a "stack overflow" diagnostic instead of corrupting memory.
+ * Under UTHREAD_POLICY_FAIR the thread gets a share of the CPU in proportion to attrs->weight. The thread joins the
+ * group attrs->group, see uthread_group_create.
+ * A thread with attrs->latency_critical set doesn't wait for its turn when it is resumed or its sleep ends: it runs
+ * next, and preempts the running thread as soon as that ran uthread_options.min_quantum_usecs of its quantum (within a
+ * timer tick), unless the running thread is latency-critical or a deadline thread itself. In M:N mode that is the
+ * running thread of the worker the thread is queued on, whichever worker resumed it or ended its sleep.
+ * Only threads with attrs->fp_env set may change their floating-point environment: each of them keeps its own, while
+ * all other threads run in the one the process had at uthread_init_ex, preempted or not. The floating-point and vector
+ * registers are kept for all threads.
+ * A null attrs is the same as all defaults. It is an error to call this function with a null entry_point, a negative
+ * stack_size or weight, or a group that doesn't exist.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_ex(thread_entry_point entry_point, const uthread_attr* attrs);
+
 
 /**
  * @brief Terminates the thread with ID tid and deletes it from all relevant control structures.
  *
  * All the resources allocated by the library for this thread should be released. If no thread with ID tid exists it
  * is considered an error. Terminating the main thread (tid == 0) will result in the termination of the entire
- * process using exit(0) (after releasing the assigned library memory).
+ * process using exit(0) (after releasing the assigned library memory). In M:N mode the other workers stop first: the
+ * threads they run are left where they are, and their pthreads are joined.
  *
  * @return The function returns 0 if the thread was successfully terminated and -1 otherwise. If a thread terminates
  * itself or the main thread is terminated, the function does not return.
@@ -80,6 +241,43 @@ int uthread_block(int tid);
 int uthread_resume(int tid);
 
 
+/**
+ * @brief Resumes the thread with ID tid like uthread_resume, from any kernel thread of the process.
+ *
+ * The other functions of the library may only be called by its threads. This one may also be called by a pthread of
+ * the program that runs outside of it, such as one that waits for input on behalf of the threads: the request is
+ * queued in a lock-free inbox, and carried out at the next switch or library call, or right away if no thread was
+ * running - an idle worker is woken up by the post. Requests are carried out in the order they were posted. Such a
+ * pthread must keep SIGVTALRM blocked, the timer signal of the library may be sent to any kernel thread of the process.
+ * Resuming a thread that is not BLOCKED by then has no effect, as does resuming one that terminated meanwhile, even if
+ * a new thread took its ID since: the request is for the thread that had the ID when it was posted.
+ * It is an error to call this function before uthread_init_ex, with a tid out of bounds, or while
+ * UTHREAD_INBOX_CAPACITY requests wait already.
+ *
+ * @return On success (the request was queued), return 0. On failure, return -1.
+*/
+int uthread_post_resume(int tid);
+
+
+/**
+ * @brief Creates a new thread like uthread_spawn, from any kernel thread of the process.
+ *
+ * The request is queued and carried out like those of uthread_post_resume, so the caller doesn't learn the ID of the
+ * new thread. If the maximum number of threads is reached by then, the error is reported when the request is carried
+ * out. The timer handler can't allocate memory, so at a preemption the request is only carried out with a thread of
+ * the pool (see uthread_options.pool_threads) that is free already, and an id the thread table has a slot for;
+ * otherwise it waits, with the requests posted after it, for the next library call or an idle worker. The first call
+ * therefore adds UTHREAD_INBOX_POOL_THREADS threads to the pool, allocated by the caller, so that that many posted
+ * threads can be alive at once while no thread calls the library. The pool is shared with uthread_spawn, and in 1:N
+ * mode the table has slots for MAX_THREAD_NUM threads until a library call grows it.
+ * It is an error to call this function before uthread_init_ex, with a null entry_point, or while
+ * UTHREAD_INBOX_CAPACITY requests wait already.
+ *
+ * @return On success (the request was queued), return 0. On failure, return -1.
+*/
+int uthread_post_spawn(thread_entry_point entry_point);
+
+
 /**
  * @brief Blocks the RUNNING thread for num_quantums quantums.
  *
@@ -96,6 +294,32 @@ int uthread_resume(int tid);
 int uthread_sleep(int num_quantums);
 
 
+/**
+ * @brief Gives up the rest of the calling thread's quantum.
+ *
+ * The calling thread is added to the READY threads as if it was preempted, and the next thread runs. A new quantum
+ * starts, for the calling thread itself if no other thread can run.
+ *
+ * @return 0.
+*/
+int uthread_yield();
+
+/**
+ * @brief Hands the rest of the calling thread's quantum to the thread with ID tid.
+ *
+ * The thread with ID tid runs right away, ahead of the other READY threads, for what is left of the calling thread's
+ * quantum, and the calling thread is added to the READY threads as if it was preempted. Switching to the thread with
+ * ID tid starts a new quantum, which is counted by uthread_get_total_quantums and uthread_get_quantums as usual. If
+ * the scheduling policy can't let the thread go first (its group used up its quota, or a deadline thread has a job to
+ * run), or the thread may not run on the calling thread's worker (see uthread_set_affinity), the call is the same as
+ * uthread_yield.
+ * It is an error to call this function with the calling thread's ID or with a thread that is not READY. If no thread
+ * with ID tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid);
+
 /**
  * @brief Returns the thread ID of the calling thread.
  *
@@ -126,5 +350,131 @@ int uthread_get_total_quantums();
 */
 int uthread_get_quantums(int tid);
 
+/**
+ * @brief Sets the length of a quantum in micro-seconds of the threads without one of their own.
+ *
+ * The quantum that is running is not cut short or stretched, the new length applies from the next quantum on. In
+ * adaptive mode (see uthread_options.adaptive_quantum) the library starts sizing the quantum again from usecs.
+ * It is an error to call this function with a non-positive usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_default_quantum(int usecs);
+
+/**
+ * @brief Sets the length of a quantum in micro-seconds of the thread with ID tid, or back to the default if usecs is 0.
+ *
+ * A thread with a quantum of its own uses it regardless of the default quantum (see uthread_set_default_quantum) and
+ * of the adaptive quantum. A quantum is rounded down to whole timer ticks (see uthread_options.timer_ticks). The
+ * quantums keep being counted as before: uthread_get_total_quantums and uthread_get_quantums count the quantums
+ * started, whatever their length. It is an error to call this function with a negative usecs. If no thread with ID
+ * tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_quantum(int tid, int usecs);
+
+/**
+ * @brief Returns the time the thread with ID tid was in RUNNING state, in micro-seconds.
+ *
+ * If the thread with ID tid is in RUNNING state when this function is called, include also the current quantum so far.
+ * If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the run time of the thread with ID tid. On failure, return -1.
+*/
+long long uthread_get_run_usecs(int tid);
+
+/**
+ * @brief Sets the workers the thread with ID tid may run on: bit i of workers stands for worker i (see
+ * uthread_options.workers).
+ *
+ * A thread keeps running on the worker it last ran on as long as that one is in its affinity, so that its stack and
+ * data stay in the caches of that worker's core. With uthread_options.pin_workers every worker runs on a CPU of its
+ * own, so the affinity is a set of CPUs. A READY thread queued on a worker that is no longer in its affinity moves to
+ * the one of its affinity with the fewest READY threads right away; the calling thread moves right away as well, as
+ * if it called uthread_yield, and a thread running on another worker moves at the end of its quantum. Bits of
+ * workers that don't exist are ignored. All threads start with all workers in their affinity.
+ * It is an error to call this function with none of the existing workers in workers. If no thread with ID tid exists
+ * it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_affinity(int tid, unsigned long long workers);
+
+/**
+ * @brief Returns the number of times the thread with ID tid was switched to on another worker than the one it last
+ * ran on.
+ *
+ * Threads only change workers in M:N mode (see uthread_options.workers): when a worker steals them, or when their
+ * affinity changes (see uthread_set_affinity). If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the number of migrations of the thread with ID tid. On failure, return -1.
+*/
+int uthread_get_migrations(int tid);
+
+/**
+ * @brief Makes the thread with ID tid a deadline thread, or a regular one again if params is null.
+ *
+ * A deadline thread runs periodic jobs: a job is released every params->period_usecs, starting right away, may use
+ * params->runtime_usecs of CPU time and is due params->deadline_usecs after its release. Deadline threads that have a
+ * job to run go before all other threads, the earliest deadline first, and preempt a thread with a later deadline or
+ * none as soon as the scheduler sees them: within a timer tick (see uthread_options.timer_ticks). A thread ends its
+ * job with uthread_wait_period, and a job that uses up its runtime is suspended until the next release, so a deadline
+ * thread can't take more than its share of the CPU from the others.
+ * A thread is only admitted if the sum of runtime / deadline over all deadline threads stays at most 1, so that every
+ * deadline can be met. Jobs that are not done by their deadline are counted, see uthread_get_deadline_misses.
+ * It is an error to call this function with a non-positive runtime_usecs or period_usecs, a negative deadline_usecs,
+ * a runtime longer than the deadline or a deadline longer than the period, if the thread is not admitted, or with
+ * several workers (see uthread_options.workers). If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_deadline(int tid, const uthread_deadline* params);
+
+/**
+ * @brief Ends the current job of the calling deadline thread, which waits for the release of its next job.
+ *
+ * A job that ends after its deadline is counted as a miss. It is an error to call this function from a thread
+ * without a deadline.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_wait_period();
+
+/**
+ * @brief Returns the number of jobs of the thread with ID tid that were not done by their deadline.
+ *
+ * If no thread with ID tid exists it is considered an error.
+ *
+ * @return On success, return the number of missed deadlines of the thread with ID tid. On failure, return -1.
+*/
+int uthread_get_deadline_misses(int tid);
+
+/**
+ * @brief Creates a thread group, which threads join when they are spawned (see uthread_attr.group).
+ *
+ * The CPU is shared among the groups first, in proportion to attrs->shares, and then among the threads of each group
+ * in proportion to their weights, so a group gets the same share however many threads it has. The threads spawned
+ * without a group are in group 0, whose share is UTHREAD_DEFAULT_WEIGHT and which schedules them by the policy chosen
+ * by uthread_init_ex. A group with attrs->quota_usecs uses at most that much CPU time per attrs->period_usecs, even
+ * if the CPU is idle otherwise. Deadline threads (see uthread_set_deadline) run before all groups.
+ * A null attrs is the same as all defaults. It is an error to call this function with a negative shares,
+ * quota_usecs or period_usecs, if there are UTHREAD_MAX_GROUPS groups already, or with several workers (see
+ * uthread_options.workers).
+ *
+ * @return On success, return the ID of the created group. On failure, return -1.
+*/
+int uthread_group_create(const uthread_group_attr* attrs);
+
+/**
+ * @brief Returns the CPU time the threads of the group with ID gid ran for, in micro-seconds.
+ *
+ * The time of threads that terminated is included. It is an error to call this function with a group that doesn't
+ * exist.
+ *
+ * @return On success, return the CPU time of the group. On failure, return -1.
+*/
+long long uthread_group_get_usage(int gid);
+
 
 #endif